@@ -0,0 +1,86 @@
+/*
+ * osmo-fl2k, turns FL2000-based USB 3.0 to VGA adapters into
+ * low cost DACs
+ *
+ * Copyright (C) 2016-2018 by Steve Markgraf <steve@steve-m.de>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FL2K_CONVERT_H
+#define __FL2K_CONVERT_H
+
+#include <stdint.h>
+
+/* The FL2000 transfers 8 samples of each DAC in a 24 byte block */
+#define FL2K_BLOCK_LEN		24
+#define FL2K_BLOCK_SAMPLES	8
+
+typedef void (*fl2k_convert_fn_t)(char *out, const char *in,
+				  uint32_t len, uint8_t offset);
+
+/* Interleaves all three DACs in a single pass, a NULL input buffer
+ * outputs the offset value on that DAC */
+typedef void (*fl2k_convert_rgb_fn_t)(char *out, const char *r_in,
+				      const char *g_in, const char *b_in,
+				      uint32_t len, uint8_t offset);
+
+/* Inverse of the above, the offset is subtracted from the samples and a
+ * NULL output buffer skips that DAC */
+typedef void (*fl2k_split_rgb_fn_t)(const char *in, char *r_out,
+				    char *g_out, char *b_out,
+				    uint32_t len, uint8_t offset);
+
+/* Narrows len samples of a wider format to unsigned 8 bit DAC values,
+ * rounding to nearest and saturating at full scale */
+typedef void (*fl2k_narrow_fn_t)(char *out, const void *in, uint32_t len);
+
+/* Maps len samples through a 256 entry table, out may equal in */
+typedef void (*fl2k_lut_fn_t)(char *out, const char *in, uint32_t len,
+			      const uint8_t *lut);
+
+typedef struct fl2k_convert_ops {
+	const char *name;
+	fl2k_convert_fn_t convert_r;
+	fl2k_convert_fn_t convert_g;
+	fl2k_convert_fn_t convert_b;
+	fl2k_convert_rgb_fn_t convert_rgb;
+	fl2k_split_rgb_fn_t split_rgb;
+	fl2k_narrow_fn_t narrow_s8;
+	fl2k_narrow_fn_t narrow_s16;
+	fl2k_narrow_fn_t narrow_u16;
+	fl2k_narrow_fn_t narrow_f32;
+	fl2k_lut_fn_t lut;
+} fl2k_convert_ops_t;
+
+/* Fastest buffer conversion implementation supported by the running CPU */
+const fl2k_convert_ops_t *fl2k_convert_select(void);
+
+/* Conversion implementation number idx out of the ones usable on the
+ * running CPU, the scalar reference is always index 0.
+ * Returns NULL if idx is out of range. */
+const fl2k_convert_ops_t *fl2k_convert_get(unsigned int idx);
+
+/* Interleaves len bytes of output from the DAC buffers in[], each in
+ * the format given by fmt[] (enum fl2k_sample_format) and mapped through
+ * lut[] unless NULL. Wider samples are narrowed and mapped in chunks that
+ * stay in the cache while being interleaved. */
+void fl2k_convert_formats(const fl2k_convert_ops_t *ops, char *out,
+			  const void *const in[3], const int fmt[3],
+			  const uint8_t *const lut[3],
+			  int sampletype_signed, uint32_t len);
+
+#endif /* __FL2K_CONVERT_H */
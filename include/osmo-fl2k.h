@@ -35,17 +35,43 @@ enum fl2k_error {
 	FL2K_TRUE = 1,
 	FL2K_ERROR_INVALID_PARAM = -1,
 	FL2K_ERROR_NO_DEVICE = -2,
+	FL2K_ERROR_ACCESS = -3,
 	FL2K_ERROR_NOT_FOUND = -5,
 	FL2K_ERROR_BUSY = -6,
 	FL2K_ERROR_TIMEOUT = -7,
 	FL2K_ERROR_NO_MEM = -11,
+	FL2K_ERROR_NOT_SUPPORTED = -12,
+};
+
+enum fl2k_thread {
+	FL2K_THREAD_USB = 0,		/* handles USB events */
+	FL2K_THREAD_SAMPLE = 1,		/* calls the callback, converts samples */
+};
+
+enum fl2k_sched_policy {
+	FL2K_SCHED_OTHER = 0,		/* default time sharing */
+	FL2K_SCHED_FIFO = 1,		/* realtime, first in first out */
+	FL2K_SCHED_RR = 2,		/* realtime, round robin */
+};
+
+enum fl2k_underflow_policy {
+	FL2K_UNDERFLOW_REPEAT = 0,	/* send the last transfer again */
+	FL2K_UNDERFLOW_SILENCE = 1,	/* send zeroes */
+	FL2K_UNDERFLOW_HOLD = 2,	/* keep the last sample of each DAC */
+};
+
+enum fl2k_sample_format {
+	FL2K_FORMAT_8BIT = 0,		/* char, signedness from sampletype_signed */
+	FL2K_FORMAT_S16 = 1,		/* int16_t, full scale -32768 to 32767 */
+	FL2K_FORMAT_U16 = 2,		/* uint16_t, full scale 0 to 65535 */
+	FL2K_FORMAT_F32 = 3,		/* float, full scale -1.0 to 1.0 */
 };
 
 typedef struct fl2k_data_info {
 	/* information provided by library */
 	void *ctx;
 	uint32_t underflow_cnt;		/* underflows since last callback */
-	uint32_t len;			/* buffer length */
+	uint32_t len;			/* samples per DAC, see fl2k_set_buffer_len() */
 	int using_zerocopy;		/* using zerocopy kernel buffers */
 	int device_error;		/* device error happened, terminate application */
 
@@ -54,10 +80,59 @@ typedef struct fl2k_data_info {
 	char *r_buf;			/* pointer to red buffer */
 	char *g_buf;			/* pointer to green buffer */
 	char *b_buf;			/* pointer to blue buffer */
+
+	/* raw transfer buffer provided by library, see fl2k_get_raw_offset() */
+	char *raw_buf;			/* pointer to the USB transfer buffer */
+	uint32_t raw_len;		/* transfer buffer length in bytes */
+
+	/* filled in by application */
+	int raw_filled;			/* raw_buf was written directly, ignore
+					 * r_buf, g_buf and b_buf */
+	int tx_timed;			/* send the buffer at tx_tick instead
+					 * of right away */
+	uint64_t tx_tick;		/* sample to send the buffer at, counted
+					 * since start, see
+					 * fl2k_submit_tx_buffer_at() */
+	int r_format;			/* sample format of r_buf, g_buf and */
+	int g_format;			/* b_buf, see enum fl2k_sample_format. */
+	int b_format;			/* Wider samples are rounded to 8 bits
+					 * and saturated at full scale */
 } fl2k_data_info_t;
 
 typedef struct fl2k_dev fl2k_dev_t;
 
+#define FL2K_STATS_HIST_BINS	20
+
+typedef struct fl2k_stats {
+	uint64_t xfers_completed;	/* transfers sent since start */
+	uint64_t bytes_sent;		/* bytes sent since start */
+	uint64_t underflows;		/* transfers repeated for lack of data */
+
+	uint64_t cb_count;		/* number of callbacks */
+	uint64_t cb_min_ns;		/* duration of the callbacks */
+	uint64_t cb_avg_ns;
+	uint64_t cb_max_ns;
+	uint64_t cb_hist[FL2K_STATS_HIST_BINS];	/* bin 0 counts callbacks
+					 * below 1 us, bin i [2^(i-1), 2^i) us,
+					 * the last bin all longer ones */
+
+	uint64_t conv_avg_ns;		/* conversion to the transfer format */
+	uint64_t conv_max_ns;
+
+	uint64_t usb_lat_avg_ns;	/* submit to completion of transfers */
+	uint64_t usb_lat_max_ns;
+
+	uint64_t wakeup_avg_ns;		/* see fl2k_get_wakeup_latency() */
+	uint64_t wakeup_max_ns;
+
+	uint32_t xfers_in_flight;	/* transfers submitted to the device */
+	uint32_t xfers_queued;		/* filled transfers waiting to be submitted */
+
+	uint64_t deadline_misses;	/* callbacks longer than a buffer lasts */
+	int64_t worst_slack_ns;		/* least time left before the deadline,
+					 * negative if it was missed */
+} fl2k_stats_t;
+
 /** The transfer length was chosen by the following criteria:
  * - Must be a supported resolution of the FL2000DX
  * - Must be a multiple of 61440 bytes (URB payload length),
@@ -65,14 +140,40 @@ typedef struct fl2k_dev fl2k_dev_t;
  *   otherwise a couple of samples are missing between every buffer
  * - Should be smaller than 4MB in order to be allocatable by kmalloc()
  *   for zerocopy transfers
+ * It is the default and maximum, see fl2k_set_buffer_len() for using
+ * shorter transfers.
  **/
 #define FL2K_BUF_LEN		(1280 * 1024)
 #define FL2K_XFER_LEN		(FL2K_BUF_LEN * 3)
 
+/* URB payload length, transfers need to be a multiple of it */
+#define FL2K_URB_LEN		61440
+#define FL2K_BUF_LEN_MIN	(FL2K_URB_LEN / 3)
+
+/*!
+ * Get the number of FL2000 devices. Setting the environment variable
+ * FL2K_VIRTUAL adds a virtual device after the real ones, which runs
+ * without hardware and sends the raw interleaved samples, paced at the
+ * sample rate, to a sink given by the variable: "null" discards them,
+ * "file:<path>" writes them to a file and "fifo:<path>" to a named pipe.
+ * The virtual device always uses threads of its own, even with
+ * fl2k_set_shared_threads(), and has no I2C bus.
+ *
+ * \return number of devices, including the virtual one
+ */
 FL2K_API uint32_t fl2k_get_device_count(void);
 
 FL2K_API const char* fl2k_get_device_name(uint32_t index);
 
+/*!
+ * Check if a device can be opened, without initializing it.
+ *
+ * \param index index of the device
+ * \return FL2K_TRUE if available, 0 if in use or inaccessible,
+ *	   FL2K_ERROR_NOT_FOUND if there is no such device
+ */
+FL2K_API int fl2k_is_device_available(uint32_t index);
+
 FL2K_API int fl2k_open(fl2k_dev_t **dev, uint32_t index);
 
 FL2K_API int fl2k_close(fl2k_dev_t *dev);
@@ -97,6 +198,48 @@ FL2K_API int fl2k_set_sample_rate(fl2k_dev_t *dev, uint32_t target_freq);
  */
 FL2K_API uint32_t fl2k_get_sample_rate(fl2k_dev_t *dev);
 
+/*!
+ * Get actual sample rate the device is configured to, without rounding
+ * it to an integer. Use this for timing calculations that have to stay
+ * coherent over long transmissions.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \return 0 on error, sample rate in Hz otherwise
+ */
+FL2K_API double fl2k_get_sample_rate_exact(fl2k_dev_t *dev);
+
+/*!
+ * Set the number of samples per DAC in each transfer, used when
+ * streaming is started the next time. Shorter transfers reduce the
+ * latency from the callback to the output, at the cost of more
+ * callbacks and USB transfers per second. The overall buffering is
+ * roughly (buf_num + 2) transfers.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param len samples per DAC, a multiple of FL2K_BUF_LEN_MIN (20480)
+ *	  up to FL2K_BUF_LEN (default)
+ * \return 0 on success, FL2K_ERROR_BUSY while streaming
+ */
+FL2K_API int fl2k_set_buffer_len(fl2k_dev_t *dev, uint32_t len);
+
+/*!
+ * Get the number of samples per DAC in each transfer, a transfer buffer
+ * in the raw format has three times this length in bytes.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \return 0 on error, buffer length otherwise
+ */
+FL2K_API uint32_t fl2k_get_buffer_len(fl2k_dev_t *dev);
+
+/*!
+ * Get all sample rates the device can be configured to.
+ *
+ * \param rates pointer to the list of sample rates in Hz, sorted in
+ *	  ascending order. The list is owned by the library.
+ * \return number of sample rates in the list, 0 on error
+ */
+FL2K_API uint32_t fl2k_list_sample_rates(const double **rates);
+
 /* streaming functions */
 
 typedef void(*fl2k_tx_cb_t)(fl2k_data_info_t *data_info);
@@ -106,14 +249,65 @@ typedef void(*fl2k_tx_cb_t)(fl2k_data_info_t *data_info);
  * it is being canceled using fl2k_stop_tx()
  *
  * \param dev the device handle given by fl2k_open()
+ * \param cb callback function to get samples from, or NULL to push
+ *	  them using fl2k_acquire_tx_buffer() and fl2k_submit_tx_buffer()
  * \param ctx user specific context to pass via the callback function
- * \param buf_num optional buffer count, buf_num * FL2K_BUF_LEN = overall buffer size
- *		  set to 0 for default buffer count (4)
+ * \param buf_num optional buffer count, buf_num * fl2k_get_buffer_len() = overall
+ *		  buffer size, set to 0 for default buffer count (4)
  * \return 0 on success
  */
 FL2K_API int fl2k_start_tx(fl2k_dev_t *dev, fl2k_tx_cb_t cb,
 		     void *ctx, uint32_t buf_num);
 
+/*!
+ * Starts transmitting a waveform that is repeated until fl2k_stop_tx()
+ * is called. The waveform is copied to the transfer buffers once, the
+ * transfers are then resubmitted by the USB worker without any further
+ * processing.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param raw_buf waveform of xfer_cnt * 3 * fl2k_get_buffer_len() bytes in the raw
+ *	  format described at fl2k_get_raw_offset(), see fl2k_interleave()
+ * \param xfer_cnt length of the waveform in transfers
+ * \param buf_num optional minimum count of transfers in flight, rounded up
+ *	  to a multiple of xfer_cnt, set to 0 for default buffer count (4)
+ * \return 0 on success, FL2K_ERROR_NO_MEM if not all transfers could be
+ *	   submitted, e.g. as the usbfs memory limit was hit, in which case
+ *	   nothing is sent
+ */
+FL2K_API int fl2k_start_tx_loop(fl2k_dev_t *dev, const char *raw_buf,
+				uint32_t xfer_cnt, uint32_t buf_num);
+
+/*!
+ * Starts streaming on several devices at once, like fl2k_start_tx() does
+ * for a single one. The transfers of all devices are allocated and the
+ * initial ones are filled by calling the callback, before they get
+ * submitted in turns, so that the devices start on the same buffer
+ * boundary as close together as possible.
+ *
+ * \param devs the device handles given by fl2k_open()
+ * \param num_devs number of devices
+ * \param cb callback function to get samples from, or NULL to push
+ *	  them using fl2k_acquire_tx_buffer() and fl2k_submit_tx_buffer()
+ * \param ctx optional array of num_devs user specific contexts to pass
+ *	  via the callback function
+ * \param buf_num optional buffer count per device, set to 0 for default
+ *	  buffer count (4)
+ * \param skew_ns optional array of num_devs, filled with the time the
+ *	  first transfer of each device completed relative to the first
+ *	  device. Waits for the first transfers to complete if given. This
+ *	  is when the host saw the completions, which includes the USB
+ *	  scheduling of each host controller, not when the DACs output the
+ *	  samples.
+ * \return 0 on success, FL2K_ERROR_TIMEOUT if the skew could not be
+ *	   measured, the devices are streaming nevertheless,
+ *	   FL2K_ERROR_NO_DEVICE or FL2K_ERROR_NO_MEM if a transfer could
+ *	   not be submitted, all devices are stopped again in this case
+ */
+FL2K_API int fl2k_start_tx_group(fl2k_dev_t **devs, uint32_t num_devs,
+				 fl2k_tx_cb_t cb, void **ctx,
+				 uint32_t buf_num, int64_t *skew_ns);
+
 /*!
  * Cancel all pending asynchronous operations on the device.
  *
@@ -122,6 +316,308 @@ FL2K_API int fl2k_start_tx(fl2k_dev_t *dev, fl2k_tx_cb_t cb,
  */
 FL2K_API int fl2k_stop_tx(fl2k_dev_t *dev);
 
+/*!
+ * Service all devices with one shared USB event thread and a pool of
+ * sample worker threads, instead of a USB and a sample worker thread per
+ * device. Applies to devices opened afterwards, the callbacks of a
+ * device are still called one at a time. Devices opened before keep
+ * their own threads.
+ *
+ * \param num_workers number of sample worker threads, 0 to go back to
+ *	  threads per device
+ * \return 0 on success, FL2K_ERROR_BUSY if a device opened while the
+ *	   shared threads were enabled is still open or they could not be
+ *	   started
+ */
+FL2K_API int fl2k_set_shared_threads(uint32_t num_workers);
+
+/*!
+ * Let the number of transfers in flight adapt to the host, for streams
+ * started afterwards. Each underflow adds a transfer up to max_buf_num,
+ * after two seconds without underflows a transfer is taken away again,
+ * down to the buf_num given when starting. This way the buffering stays
+ * as low as the host allows. The transfers for the maximum depth are
+ * allocated when starting. Has no effect on fl2k_start_tx_loop().
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param max_buf_num maximum count of transfers in flight, 0 to keep
+ *	  the buffer count fixed (default)
+ * \return 0 on success, FL2K_ERROR_BUSY while streaming
+ */
+FL2K_API int fl2k_set_adaptive_buf_num(fl2k_dev_t *dev, uint32_t max_buf_num);
+
+/*!
+ * Select what is sent when no samples are ready in time, for streams
+ * started afterwards. By default the last transfer is sent again, which
+ * replays stale samples. With FL2K_UNDERFLOW_SILENCE all DACs output
+ * zero, with FL2K_UNDERFLOW_HOLD they keep the level of the last sample
+ * sent, until new samples are ready. Both use transfers allocated when
+ * starting, without involving the callback. The underflows are still
+ * reported by fl2k_data_info_t.underflow_cnt. Has no effect on
+ * fl2k_start_tx_loop().
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param policy one of enum fl2k_underflow_policy
+ * \return 0 on success, FL2K_ERROR_BUSY while streaming
+ */
+FL2K_API int fl2k_set_underflow_policy(fl2k_dev_t *dev, int policy);
+
+/*!
+ * Set a table mapping the values of a DAC, e.g. to correct its
+ * nonlinearity or the imbalance between the channels. It is applied
+ * while the library interleaves the samples of the callback, without
+ * another pass over the buffers. The index is the unsigned value the
+ * DAC would get otherwise, i.e. after adding 128 to signed samples and
+ * narrowing wider formats. Can be called while streaming, the table is
+ * replaced as a whole before the next buffer is converted. Buffers
+ * written directly (raw_filled, fl2k_acquire_tx_buffer() and
+ * fl2k_start_tx_loop()) are sent unchanged.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param dac 0 for red, 1 for green, 2 for blue
+ * \param lut 256 output values, NULL to remove the table
+ * \return 0 on success
+ */
+FL2K_API int fl2k_set_dac_lut(fl2k_dev_t *dev, uint32_t dac,
+			      const uint8_t *lut);
+
+/*!
+ * Set the gain and offset of a DAC, as a table for fl2k_set_dac_lut()
+ * mapping value n to gain * n + offset, rounded and clamped to 0..255.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param dac 0 for red, 1 for green, 2 for blue
+ * \param gain factor for the DAC values, 1.0 for unity
+ * \param offset added after scaling, in DAC steps
+ * \return 0 on success
+ */
+FL2K_API int fl2k_set_dac_gain(fl2k_dev_t *dev, uint32_t dac, double gain,
+			       double offset);
+
+/*!
+ * Get the count of transfers currently kept in flight, which changes
+ * over time when fl2k_set_adaptive_buf_num() is used.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \return transfer count, 0 if not streaming
+ */
+FL2K_API uint32_t fl2k_get_buf_num(fl2k_dev_t *dev);
+
+/*!
+ * Get an empty transfer buffer to be filled with samples, when streaming
+ * was started without a callback. The buffer has a length of
+ * 3 * fl2k_get_buffer_len() bytes and is in the raw format described at
+ * fl2k_get_raw_offset(), fl2k_interleave() can be used to fill it.
+ *
+ * Every acquired buffer has to be handed back with fl2k_submit_tx_buffer(),
+ * even after streaming stopped, as the buffers are only freed once all
+ * of them are returned.
+ *
+ * Buffers are acquired by a single thread at a time, a call made while
+ * another thread is still in fl2k_acquire_tx_buffer() fails with
+ * FL2K_ERROR_BUSY. The submitting thread may be a different one.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param buf pointer to the transfer buffer
+ * \param timeout_ms time to wait for an empty buffer, -1 to wait forever,
+ *	  0 to return immediately
+ * \return 0 on success, FL2K_ERROR_TIMEOUT if no buffer got available in
+ *	   time, FL2K_ERROR_BUSY if not streaming or another thread is
+ *	   acquiring a buffer, or FL2K_ERROR_NO_DEVICE if the device was lost
+ */
+FL2K_API int fl2k_acquire_tx_buffer(fl2k_dev_t *dev, char **buf,
+				    int timeout_ms);
+
+/*!
+ * Queue a buffer obtained by fl2k_acquire_tx_buffer() for transmission.
+ * Each acquired buffer can only be submitted once. Like acquiring,
+ * submitting is done by a single thread at a time, a concurrent call
+ * fails with FL2K_ERROR_BUSY and leaves the buffer acquired.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param buf the filled transfer buffer
+ * \return 0 on success, FL2K_ERROR_BUSY if streaming stopped (the buffer
+ *	   is returned nevertheless) or another thread is submitting a
+ *	   buffer, FL2K_ERROR_NO_DEVICE if the device was lost or
+ *	   FL2K_ERROR_INVALID_PARAM if buf is not an acquired buffer
+ */
+FL2K_API int fl2k_submit_tx_buffer(fl2k_dev_t *dev, char *buf);
+
+/*!
+ * Queue a buffer obtained by fl2k_acquire_tx_buffer() for transmission
+ * at a given sample, counted since streaming started like
+ * fl2k_get_sample_count() does. Until then, the transfers selected by
+ * fl2k_set_underflow_policy() are sent, silence unless holding the last
+ * samples. Transfers can only start on multiples of
+ * fl2k_get_buffer_len(), so tick has to be one of them, samples before
+ * an unaligned time have to be padded by the application. The buffer
+ * goes out right away if tick already passed. Buffers queued afterwards
+ * wait for this one. The same works for the callback by setting
+ * fl2k_data_info_t.tx_timed and tx_tick, an unaligned one is sent on the
+ * next boundary and reported as late by the fl2k_set_tx_done_hook() hook.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param buf the filled transfer buffer
+ * \param tick sample to send the first sample of the buffer at, a
+ *	  multiple of fl2k_get_buffer_len()
+ * \return see fl2k_submit_tx_buffer(), FL2K_ERROR_INVALID_PARAM also
+ *	   if tick is not a multiple of the buffer length, the buffer stays
+ *	   acquired then
+ */
+FL2K_API int fl2k_submit_tx_buffer_at(fl2k_dev_t *dev, char *buf,
+				      uint64_t tick);
+
+typedef void(*fl2k_tx_done_hook_t)(void *ctx, uint64_t tick,
+				   uint64_t target_tick, int timed);
+
+/*!
+ * Set a function to be called when a transfer with samples of the
+ * application was sent, with the sample it actually started at and,
+ * if timed is set, the one it was scheduled for. Silence or held
+ * samples sent for underflows or while waiting are not reported, a
+ * transfer repeated for an underflow is reported again. It is called by
+ * the USB worker thread, and needs to return quickly. The hook can only be
+ * changed while the device is not streaming.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param hook function to be called, NULL to disable
+ * \param ctx user specific context to pass to the hook
+ * \return 0 on success, FL2K_ERROR_BUSY while streaming
+ */
+FL2K_API int fl2k_set_tx_done_hook(fl2k_dev_t *dev, fl2k_tx_done_hook_t hook,
+				   void *ctx);
+
+/*!
+ * Interleave the samples of the three DACs into a raw transfer buffer,
+ * like the library does for the callback buffers.
+ *
+ * \param raw_buf the transfer buffer
+ * \param raw_len length of the transfer buffer in bytes, raw_len / 3
+ *	  samples are read from each input buffer
+ * \param r_buf red samples, NULL to keep the DAC at its zero level
+ * \param g_buf green samples, NULL to keep the DAC at its zero level
+ * \param b_buf blue samples, NULL to keep the DAC at its zero level
+ * \param sampletype_signed 1 if the samples are signed, 0 if unsigned
+ */
+FL2K_API void fl2k_interleave(char *raw_buf, uint32_t raw_len,
+			      const char *r_buf, const char *g_buf,
+			      const char *b_buf, int sampletype_signed);
+
+/*!
+ * Split a raw transfer buffer back into the samples of the three DACs,
+ * the inverse of fl2k_interleave(). Can be used for checking the output
+ * of the virtual device, see fl2k_get_device_count().
+ *
+ * \param raw_buf the transfer buffer
+ * \param raw_len length of the transfer buffer in bytes, a multiple of
+ *	  24, raw_len / 3 samples are written to each output buffer
+ * \param r_buf buffer for the red samples, NULL to skip the DAC
+ * \param g_buf buffer for the green samples, NULL to skip the DAC
+ * \param b_buf buffer for the blue samples, NULL to skip the DAC
+ * \param sampletype_signed 1 to get signed samples, 0 for unsigned
+ */
+FL2K_API void fl2k_deinterleave(const char *raw_buf, uint32_t raw_len,
+				char *r_buf, char *g_buf, char *b_buf,
+				int sampletype_signed);
+
+/*!
+ * Get the position of a sample in a raw transfer buffer. The FL2000
+ * transfers 8 samples of each DAC in a block of 24 bytes, with the
+ * following layout (R0 being the first red sample of the block):
+ *
+ *   G1 R1 B2 G2 B0 G0 R0 B1 B4 G4 R4 B5 R2 B3 G3 R3 R6 B7 G7 R7 G5 R5 B6 G6
+ *
+ * Samples are unsigned, 0 is the lowest DAC output level.
+ *
+ * \param channel 0 for red, 1 for green, 2 for blue
+ * \param sample index of the sample within the transfer
+ * \return byte offset of the sample in the transfer buffer
+ */
+FL2K_API uint32_t fl2k_get_raw_offset(uint32_t channel, uint32_t sample);
+
+/*!
+ * Get the number of samples per DAC transmitted since streaming started,
+ * which is updated every time a transfer completes.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param count number of samples transmitted
+ * \param timestamp_ns time of the last transfer completion in ns, on the
+ *	  monotonic clock (CLOCK_MONOTONIC, QueryPerformanceCounter() on
+ *	  Windows)
+ * \return 0 on success
+ */
+FL2K_API int fl2k_get_sample_count(fl2k_dev_t *dev, uint64_t *count,
+				   uint64_t *timestamp_ns);
+
+/*!
+ * Get statistics of the stream, since it was started. Use them to size
+ * the buffers and to spot hosts that are close to their limits.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param stats statistics to be filled in
+ * \return 0 on success
+ */
+FL2K_API int fl2k_get_stats(fl2k_dev_t *dev, fl2k_stats_t *stats);
+
+typedef void(*fl2k_deadline_hook_t)(void *ctx, uint64_t cb_ns,
+				    uint64_t deadline_ns);
+
+/*!
+ * Set a function to be called whenever the application callback took
+ * longer than the buffer it fills lasts at the current sample rate, so
+ * that the device will run out of samples sooner or later. The hook is
+ * called from the sample worker thread, right after the late callback.
+ * It can only be changed while the device is not streaming.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param hook function to be called, NULL to disable
+ * \param ctx user specific context to pass to the hook
+ * \return 0 on success, FL2K_ERROR_BUSY while streaming
+ */
+FL2K_API int fl2k_set_deadline_hook(fl2k_dev_t *dev, fl2k_deadline_hook_t hook,
+				    void *ctx);
+
+/*!
+ * Get the latency of waking up the sample worker thread once a USB
+ * transfer completed and it was waiting for an empty buffer. High
+ * values indicate that scheduling jitter on the host is eating into
+ * the buffering headroom, rather than the time needed for producing
+ * the samples.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param avg_ns average wakeup latency in ns since fl2k_start_tx()
+ * \param max_ns maximum wakeup latency in ns since fl2k_start_tx()
+ * \return 0 on success
+ */
+FL2K_API int fl2k_get_wakeup_latency(fl2k_dev_t *dev, uint64_t *avg_ns,
+				     uint64_t *max_ns);
+
+/*!
+ * Set the scheduling policy, nice level and CPU affinity of one of the
+ * threads the library starts for a device. Settings made before
+ * fl2k_start_tx() are applied when the thread starts, otherwise they are
+ * applied immediately to the running thread. Threads shared between
+ * devices (see fl2k_set_shared_threads()) are not affected.
+ *
+ * Realtime policies need the CAP_SYS_NICE capability or a sufficient
+ * RLIMIT_RTPRIO, lowering the nice level below 0 needs CAP_SYS_NICE or
+ * RLIMIT_NICE. If the settings can't be applied when a thread starts,
+ * a message is printed and the thread keeps running with the defaults.
+ *
+ * \param dev the device handle given by fl2k_open()
+ * \param thread FL2K_THREAD_USB or FL2K_THREAD_SAMPLE
+ * \param policy one of enum fl2k_sched_policy
+ * \param priority realtime priority, 0 for FL2K_SCHED_OTHER
+ * \param nice nice level from -20 to 19, only used with FL2K_SCHED_OTHER,
+ *	  0 leaves the nice level of the thread unchanged
+ * \param cpu_mask bit n allows running on CPU n, 0 for all CPUs
+ * \return 0 on success, FL2K_ERROR_ACCESS if the running thread could not
+ *	   be changed for lack of privileges, FL2K_ERROR_NOT_SUPPORTED if
+ *	   nice levels or CPU affinity are not supported on this platform
+ */
+FL2K_API int fl2k_set_thread_sched(fl2k_dev_t *dev, int thread, int policy,
+				   int priority, int nice, uint64_t cpu_mask);
+
 /*!
  * Read 4 bytes via the FL2K I2C bus
  *
@@ -0,0 +1,55 @@
+/*
+ * osmo-fl2k, turns FL2000-based USB 3.0 to VGA adapters into
+ * low cost DACs
+ *
+ * Copyright (C) 2016-2018 by Steve Markgraf <steve@steve-m.de>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __FL2K_THREAD_OPTS_H
+#define __FL2K_THREAD_OPTS_H
+
+#include <stdint.h>
+#include "osmo-fl2k.h"
+
+/* Command line options shared by the tools for the scheduling of the
+ * library threads, see fl2k_set_thread_sched() */
+#define THREAD_OPTS		"P:N:A:"
+#define THREAD_OPTS_USAGE \
+	"\t[-P realtime scheduling of the library threads, fifo:<prio> or rr:<prio>]\n" \
+	"\t[-N nice level of the library threads]\n" \
+	"\t[-A CPU affinity mask of the library threads, e.g. 0xc]\n"
+
+typedef struct thread_opts {
+	int set;
+	int policy;
+	int priority;
+	int nice;
+	uint64_t cpu_mask;
+} thread_opts_t;
+
+/* Parse one of the THREAD_OPTS options, returns 0 on success and
+ * -1 if the argument is invalid */
+int thread_opts_parse(thread_opts_t *opts, int opt, const char *arg);
+
+/* Apply the parsed options to the library threads of dev, to be called
+ * before fl2k_start_tx(). Returns 0 on success or an fl2k error code
+ * after printing a message. */
+int thread_opts_apply(thread_opts_t *opts, fl2k_dev_t *dev);
+
+#endif /* __FL2K_THREAD_OPTS_H */
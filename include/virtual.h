@@ -0,0 +1,58 @@
+/*
+ * osmo-fl2k, turns FL2000-based USB 3.0 to VGA adapters into
+ * low cost DACs
+ *
+ * Copyright (C) 2016-2018 by Steve Markgraf <steve@steve-m.de>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FL2K_VIRTUAL_H
+#define __FL2K_VIRTUAL_H
+
+#include <stdint.h>
+#include <libusb.h>
+
+/* Emulation of an FL2000 without hardware, for testing and benchmarking.
+ * It is enabled by setting the environment variable below, which adds a
+ * device after the real ones. Its value selects where the samples go, in
+ * the raw interleaved transfer format:
+ *   null		discard them
+ *   file:<path>	write them to a file
+ *   fifo:<path>	write them to a named pipe, created if missing */
+#define FL2K_VIRTUAL_ENV	"FL2K_VIRTUAL"
+
+typedef struct fl2k_virtual fl2k_virtual_t;
+
+/* Returns 1 if the virtual device is enabled */
+int fl2k_virtual_enabled(void);
+
+/* Open the sink selected by the environment, opening a FIFO blocks until
+ * there is a reader. Returns NULL on failure. */
+fl2k_virtual_t *fl2k_virtual_open(void);
+void fl2k_virtual_close(fl2k_virtual_t *virt);
+
+/* Stand-ins for the libusb transfer functions. The transfers complete one
+ * after another, paced by the number of samples each of them holds at
+ * the given rate, and are written to the sink when completing. Without a
+ * rate they complete as fast as they are submitted. */
+int fl2k_virtual_submit(fl2k_virtual_t *virt, struct libusb_transfer *xfer,
+			uint32_t samples, double rate);
+int fl2k_virtual_cancel(fl2k_virtual_t *virt, struct libusb_transfer *xfer);
+int fl2k_virtual_handle_events(fl2k_virtual_t *virt, struct timeval *tv,
+			       int *completed);
+
+#endif /* __FL2K_VIRTUAL_H */
@@ -39,13 +39,11 @@ SoapySDR::KwargsList findOsmoFL2K(const SoapySDR::Kwargs &args)
             bool deviceAvailable = false;
             SoapySDR_logf(SOAPY_SDR_DEBUG, "Device #%d: %s", i, deviceName.c_str());
             
-            // Open the device to make sure it's available
-			fl2k_dev_t *devTest;
-			if (fl2k_open(&devTest, i) == 0)
-			{
-				deviceAvailable = true;
-				fl2k_close(devTest);
-			}
+            // Make sure the device isn't used by someone else
+            if (fl2k_is_device_available(i) == FL2K_TRUE)
+            {
+                deviceAvailable = true;
+            }
 			
 			if (!deviceAvailable)
             {
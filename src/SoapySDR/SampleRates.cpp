@@ -1,3144 +1,43 @@
 #include "SoapyOsmoFL2K.hpp"
 #include <vector>
 
-static double SoapyOsmoFL2KSampleRates[] = {
-7777777.000000,
-7903225.000000,
-7936507.000000,
-8032786.000000,
-8064515.000000,
-8095237.000000,
-8166666.000000,
-8196720.000000,
-8225805.000000,
-8253967.000000,
-8305084.000000,
-8333332.000000,
-8360654.000000,
-8387095.000000,
-8412697.000000,
-8448275.000000,
-8474575.000000,
-8499998.000000,
-8524588.000000,
-8548385.000000,
-8571427.000000,
-8596490.000000,
-8620688.000000,
-8644066.000000,
-8666664.000000,
-8688522.000000,
-8709675.000000,
-8730157.000000,
-8749999.000000,
-8771928.000000,
-8793101.000000,
-8813557.000000,
-8833330.000000,
-8852456.000000,
-8870965.000000,
-8888887.000000,
-8909090.000000,
-8928570.000000,
-8947366.000000,
-8965514.000000,
-8983048.000000,
-8999996.000000,
-9016390.000000,
-9032255.000000,
-9047617.000000,
-9074073.000000,
-9090908.000000,
-9107141.000000,
-9122804.000000,
-9137927.000000,
-9152539.000000,
-9166662.000000,
-9180324.000000,
-9193545.000000,
-9206347.000000,
-9245282.000000,
-9259258.000000,
-9272726.000000,
-9285712.000000,
-9298242.000000,
-9310340.000000,
-9322030.000000,
-9333328.000000,
-9344258.000000,
-9354835.000000,
-9365077.000000,
-9423076.000000,
-9433961.000000,
-9444443.000000,
-9454544.000000,
-9464283.000000,
-9473680.000000,
-9482753.000000,
-9491521.000000,
-9499994.000000,
-9508192.000000,
-9516125.000000,
-9523807.000000,
-9607842.000000,
-9615383.000000,
-9622640.000000,
-9629628.000000,
-9636362.000000,
-9642854.000000,
-9649118.000000,
-9655166.000000,
-9661012.000000,
-9666660.000000,
-9672126.000000,
-9677415.000000,
-9682537.000000,
-9800000.000000,
-9803920.000000,
-9807690.000000,
-9811319.000000,
-9814813.000000,
-9818180.000000,
-9821425.000000,
-9824556.000000,
-9827579.000000,
-9830503.000000,
-9833326.000000,
-9836060.000000,
-9838705.000000,
-9841267.000000,
-9999992.000000,
-9999994.000000,
-9999995.000000,
-9999996.000000,
-9999997.000000,
-9999998.000000,
-9999999.000000,
-10000000.000000,
-10161285.000000,
-10163928.000000,
-10166658.000000,
-10169485.000000,
-10172405.000000,
-10175432.000000,
-10178567.000000,
-10181816.000000,
-10185183.000000,
-10188677.000000,
-10192304.000000,
-10196076.000000,
-10200000.000000,
-10204080.000000,
-10208333.000000,
-10317460.000000,
-10327862.000000,
-10333324.000000,
-10338976.000000,
-10344818.000000,
-10350870.000000,
-10357138.000000,
-10363634.000000,
-10370368.000000,
-10377356.000000,
-10384611.000000,
-10392154.000000,
-10400000.000000,
-10408161.000000,
-10416666.000000,
-10425530.000000,
-10476190.000000,
-10483870.000000,
-10499990.000000,
-10508467.000000,
-10517231.000000,
-10526308.000000,
-10535709.000000,
-10545452.000000,
-10555553.000000,
-10566035.000000,
-10576918.000000,
-10588232.000000,
-10600000.000000,
-10612242.000000,
-10624999.000000,
-10634920.000000,
-10638295.000000,
-10645160.000000,
-10652173.000000,
-10655737.000000,
-10677958.000000,
-10689644.000000,
-10701746.000000,
-10714280.000000,
-10727270.000000,
-10740738.000000,
-10754714.000000,
-10769225.000000,
-10784310.000000,
-10793650.000000,
-10800000.000000,
-10806450.000000,
-10816323.000000,
-10819671.000000,
-10833332.000000,
-10851060.000000,
-10862057.000000,
-10869564.000000,
-10877184.000000,
-10888888.000000,
-10892851.000000,
-10909088.000000,
-10925923.000000,
-10943393.000000,
-10952380.000000,
-10961532.000000,
-10967740.000000,
-10980388.000000,
-10983605.000000,
-10999998.000000,
-11000000.000000,
-11016948.000000,
-11020404.000000,
-11041665.000000,
-11052622.000000,
-11063825.000000,
-11071422.000000,
-11086955.000000,
-11090906.000000,
-11111108.000000,
-11111110.000000,
-11129030.000000,
-11132072.000000,
-11136362.000000,
-11147539.000000,
-11153839.000000,
-11166664.000000,
-11176466.000000,
-11186439.000000,
-11200000.000000,
-11206895.000000,
-11224485.000000,
-11249993.000000,
-11249998.000000,
-11269840.000000,
-11272724.000000,
-11276590.000000,
-11290320.000000,
-11296293.000000,
-11304346.000000,
-11311473.000000,
-11320751.000000,
-11333330.000000,
-11333332.000000,
-11346146.000000,
-11355930.000000,
-11363634.000000,
-11372544.000000,
-11379308.000000,
-11395348.000000,
-11400000.000000,
-11403508.000000,
-11428566.000000,
-11428570.000000,
-11451610.000000,
-11454542.000000,
-11458331.000000,
-11475407.000000,
-11481478.000000,
-11489355.000000,
-11499996.000000,
-11509430.000000,
-11521737.000000,
-11525421.000000,
-11538453.000000,
-11551721.000000,
-11555554.000000,
-11568622.000000,
-11578946.000000,
-11587300.000000,
-11590906.000000,
-11600000.000000,
-11607142.000000,
-11612900.000000,
-11627906.000000,
-11632647.000000,
-11639341.000000,
-11666662.000000,
-11666663.000000,
-11666664.000000,
-11666666.000000,
-11694912.000000,
-11698109.000000,
-11702120.000000,
-11724134.000000,
-11730760.000000,
-11739128.000000,
-11746030.000000,
-11754384.000000,
-11764700.000000,
-11774190.000000,
-11777776.000000,
-11785713.000000,
-11800000.000000,
-11803275.000000,
-11818178.000000,
-11818181.000000,
-11833328.000000,
-11836728.000000,
-11860464.000000,
-11864403.000000,
-11874997.000000,
-11886788.000000,
-11896547.000000,
-11904760.000000,
-11904761.000000,
-11914885.000000,
-11923067.000000,
-11929822.000000,
-11935480.000000,
-11951219.000000,
-11956519.000000,
-11960778.000000,
-11964284.000000,
-11967209.000000,
-11999994.000000,
-11999998.000000,
-11999999.000000,
-12000000.000000,
-12033894.000000,
-12037036.000000,
-12040809.000000,
-12045450.000000,
-12063490.000000,
-12068960.000000,
-12083330.000000,
-12093022.000000,
-12096770.000000,
-12105260.000000,
-12115374.000000,
-12127650.000000,
-12131143.000000,
-12142855.000000,
-12142856.000000,
-12156856.000000,
-12166660.000000,
-12173910.000000,
-12181817.000000,
-12195121.000000,
-12200000.000000,
-12203385.000000,
-12222220.000000,
-12222221.000000,
-12241373.000000,
-12244890.000000,
-12250000.000000,
-12258060.000000,
-12264150.000000,
-12272722.000000,
-12280698.000000,
-12291663.000000,
-12295077.000000,
-12321426.000000,
-12325580.000000,
-12333326.000000,
-12340415.000000,
-12352934.000000,
-12363635.000000,
-12372876.000000,
-12380950.000000,
-12380951.000000,
-12391301.000000,
-12400000.000000,
-12407406.000000,
-12413786.000000,
-12419350.000000,
-12439023.000000,
-12444442.000000,
-12448971.000000,
-12452829.000000,
-12456136.000000,
-12459011.000000,
-12499992.000000,
-12499994.000000,
-12499996.000000,
-12499997.000000,
-12499999.000000,
-12500000.000000,
-12539680.000000,
-12542367.000000,
-12545453.000000,
-12553180.000000,
-12558138.000000,
-12564102.000000,
-12580640.000000,
-12586199.000000,
-12592591.000000,
-12600000.000000,
-12608692.000000,
-12619046.000000,
-12622945.000000,
-12631574.000000,
-12641508.000000,
-12653052.000000,
-12666658.000000,
-12666664.000000,
-12678568.000000,
-12682925.000000,
-12692306.000000,
-12708329.000000,
-12711858.000000,
-12727266.000000,
-12727271.000000,
-12741930.000000,
-12745097.000000,
-12750000.000000,
-12758612.000000,
-12765945.000000,
-12777776.000000,
-12786879.000000,
-12790696.000000,
-12807012.000000,
-12820512.000000,
-12826083.000000,
-12830187.000000,
-12833324.000000,
-12857133.000000,
-12857139.000000,
-12857141.000000,
-12857142.000000,
-12881349.000000,
-12884613.000000,
-12888886.000000,
-12894735.000000,
-12909089.000000,
-12916662.000000,
-12926827.000000,
-12931025.000000,
-12941175.000000,
-12950813.000000,
-12954538.000000,
-12962961.000000,
-12978710.000000,
-12982450.000000,
-12999990.000000,
-13000000.000000,
-13015872.000000,
-13018866.000000,
-13023254.000000,
-13035710.000000,
-13043474.000000,
-13050840.000000,
-13064515.000000,
-13076920.000000,
-13076922.000000,
-13090907.000000,
-13095236.000000,
-13103438.000000,
-13111108.000000,
-13124995.000000,
-13137253.000000,
-13148146.000000,
-13157888.000000,
-13157892.000000,
-13166656.000000,
-13170729.000000,
-13174602.000000,
-13181810.000000,
-13191475.000000,
-13200000.000000,
-13207545.000000,
-13214281.000000,
-13220331.000000,
-13225805.000000,
-13243242.000000,
-13250000.000000,
-13255812.000000,
-13260865.000000,
-13265305.000000,
-13269227.000000,
-13272725.000000,
-13275851.000000,
-13278688.000000,
-13333326.000000,
-13333330.000000,
-13333331.000000,
-13333332.000000,
-13387095.000000,
-13389822.000000,
-13392852.000000,
-13396224.000000,
-13400000.000000,
-13404240.000000,
-13409082.000000,
-13414631.000000,
-13421049.000000,
-13442622.000000,
-13448264.000000,
-13454543.000000,
-13461534.000000,
-13469386.000000,
-13478256.000000,
-13488370.000000,
-13492062.000000,
-13499999.000000,
-13500000.000000,
-13508764.000000,
-13513512.000000,
-13518516.000000,
-13529409.000000,
-13541666.000000,
-13548385.000000,
-13555552.000000,
-13571423.000000,
-13571426.000000,
-13584903.000000,
-13589742.000000,
-13600000.000000,
-13606556.000000,
-13611110.000000,
-13620677.000000,
-13636354.000000,
-13636361.000000,
-13650792.000000,
-13653841.000000,
-13658533.000000,
-13666665.000000,
-13673467.000000,
-13684202.000000,
-13684206.000000,
-13695647.000000,
-13703701.000000,
-13709675.000000,
-13720928.000000,
-13725487.000000,
-13728813.000000,
-13749994.000000,
-13749999.000000,
-13750000.000000,
-13770490.000000,
-13773582.000000,
-13777774.000000,
-13783782.000000,
-13800000.000000,
-13809521.000000,
-13809522.000000,
-13818179.000000,
-13829786.000000,
-13833331.000000,
-13846148.000000,
-13846152.000000,
-13859640.000000,
-13863626.000000,
-13870965.000000,
-13877548.000000,
-13888886.000000,
-13888887.000000,
-13898304.000000,
-13902435.000000,
-13921565.000000,
-13928565.000000,
-13934424.000000,
-13947363.000000,
-13953486.000000,
-13958332.000000,
-13962261.000000,
-13965516.000000,
-13968252.000000,
-13999996.000000,
-13999997.000000,
-13999999.000000,
-14000000.000000,
-14032255.000000,
-14038455.000000,
-14042551.000000,
-14047616.000000,
-14054052.000000,
-14067795.000000,
-14074071.000000,
-14081629.000000,
-14090898.000000,
-14098358.000000,
-14102562.000000,
-14107136.000000,
-14117643.000000,
-14126982.000000,
-14130434.000000,
-14137929.000000,
-14146337.000000,
-14150940.000000,
-14166663.000000,
-14166664.000000,
-14166665.000000,
-14181815.000000,
-14186044.000000,
-14193545.000000,
-14200000.000000,
-14210520.000000,
-14210525.000000,
-14230762.000000,
-14237286.000000,
-14250000.000000,
-14255316.000000,
-14259256.000000,
-14262292.000000,
-14285710.000000,
-14285711.000000,
-14285712.000000,
-14285713.000000,
-14310342.000000,
-14313721.000000,
-14318170.000000,
-14324322.000000,
-14333329.000000,
-14339619.000000,
-14347825.000000,
-14354835.000000,
-14358972.000000,
-14363633.000000,
-14374998.000000,
-14385963.000000,
-14390239.000000,
-14400000.000000,
-14406777.000000,
-14411764.000000,
-14418602.000000,
-14423069.000000,
-14426226.000000,
-14444441.000000,
-14444442.000000,
-14444444.000000,
-14464285.000000,
-14468081.000000,
-14473677.000000,
-14482755.000000,
-14489791.000000,
-14499995.000000,
-14500000.000000,
-14509799.000000,
-14516125.000000,
-14523806.000000,
-14528298.000000,
-14561401.000000,
-14565216.000000,
-14571427.000000,
-14576268.000000,
-14583331.000000,
-14590160.000000,
-14594592.000000,
-14600000.000000,
-14603172.000000,
-14615376.000000,
-14615382.000000,
-14629626.000000,
-14634141.000000,
-14642856.000000,
-14651160.000000,
-14655168.000000,
-14666661.000000,
-14666666.000000,
-14677415.000000,
-14680846.000000,
-14693872.000000,
-14705877.000000,
-14705881.000000,
-14716977.000000,
-14722218.000000,
-14727272.000000,
-14736834.000000,
-14736839.000000,
-14745759.000000,
-14750000.000000,
-14754094.000000,
-14761901.000000,
-14761902.000000,
-14772726.000000,
-14782607.000000,
-14791664.000000,
-14800000.000000,
-14807683.000000,
-14821427.000000,
-14827581.000000,
-14833327.000000,
-14838705.000000,
-14848484.000000,
-14857141.000000,
-14864862.000000,
-14871792.000000,
-14878043.000000,
-14888888.000000,
-14893611.000000,
-14897953.000000,
-14901955.000000,
-14905656.000000,
-14909090.000000,
-14912277.000000,
-14915250.000000,
-14918028.000000,
-14920632.000000,
-14999990.000000,
-14999991.000000,
-14999993.000000,
-14999994.000000,
-14999995.000000,
-14999996.000000,
-14999997.000000,
-14999998.000000,
-14999999.000000,
-15000000.000000,
-15079362.000000,
-15081962.000000,
-15084741.000000,
-15087715.000000,
-15090908.000000,
-15098033.000000,
-15102034.000000,
-15106376.000000,
-15111110.000000,
-15116278.000000,
-15121945.000000,
-15128202.000000,
-15135132.000000,
-15142855.000000,
-15151514.000000,
-15161285.000000,
-15166659.000000,
-15172407.000000,
-15178569.000000,
-15185184.000000,
-15192297.000000,
-15200000.000000,
-15208330.000000,
-15217389.000000,
-15227270.000000,
-15245896.000000,
-15250000.000000,
-15254232.000000,
-15263148.000000,
-15263153.000000,
-15272726.000000,
-15277772.000000,
-15283018.000000,
-15294111.000000,
-15294115.000000,
-15306115.000000,
-15312500.000000,
-15319141.000000,
-15322575.000000,
-15333325.000000,
-15333332.000000,
-15344820.000000,
-15348836.000000,
-15357140.000000,
-15365847.000000,
-15370369.000000,
-15384612.000000,
-15396825.000000,
-15400000.000000,
-15405402.000000,
-15409830.000000,
-15416663.000000,
-15423723.000000,
-15428569.000000,
-15434780.000000,
-15438591.000000,
-15454542.000000,
-15454544.000000,
-15471697.000000,
-15476190.000000,
-15490189.000000,
-15499991.000000,
-15500000.000000,
-15510196.000000,
-15517233.000000,
-15526305.000000,
-15531906.000000,
-15535711.000000,
-15555549.000000,
-15555554.000000,
-15555555.000000,
-15573764.000000,
-15576922.000000,
-15581394.000000,
-15588232.000000,
-15593214.000000,
-15600000.000000,
-15614029.000000,
-15624996.000000,
-15625000.000000,
-15636362.000000,
-15641022.000000,
-15645160.000000,
-15652171.000000,
-15660376.000000,
-15666657.000000,
-15675672.000000,
-15681814.000000,
-15689646.000000,
-15714277.000000,
-15714282.000000,
-15714283.000000,
-15714285.000000,
-15740739.000000,
-15744671.000000,
-15750000.000000,
-15757574.000000,
-15762705.000000,
-15769229.000000,
-15777776.000000,
-15789462.000000,
-15789467.000000,
-15800000.000000,
-15806450.000000,
-15813952.000000,
-15818180.000000,
-15833323.000000,
-15833326.000000,
-15833329.000000,
-15849055.000000,
-15853658.000000,
-15862059.000000,
-15869562.000000,
-15873015.000000,
-15882349.000000,
-15882352.000000,
-15892853.000000,
-15897432.000000,
-15901638.000000,
-15909086.000000,
-15918358.000000,
-15925924.000000,
-15932196.000000,
-15937500.000000,
-15945942.000000,
-15952380.000000,
-15957436.000000,
-15961536.000000,
-15964905.000000,
-15967740.000000,
-15999997.000000,
-15999998.000000,
-16031745.000000,
-16034472.000000,
-16037734.000000,
-16041662.000000,
-16046510.000000,
-16052619.000000,
-16060604.000000,
-16065572.000000,
-16071424.000000,
-16078430.000000,
-16086953.000000,
-16097560.000000,
-16101687.000000,
-16111103.000000,
-16111109.000000,
-16122439.000000,
-16129030.000000,
-16136358.000000,
-16140343.000000,
-16153842.000000,
-16153843.000000,
-16166666.000000,
-16170201.000000,
-16176466.000000,
-16181816.000000,
-16190475.000000,
-16200000.000000,
-16206885.000000,
-16216212.000000,
-16222220.000000,
-16226413.000000,
-16229506.000000,
-16249995.000000,
-16250000.000000,
-16274508.000000,
-16279068.000000,
-16285711.000000,
-16290320.000000,
-16296294.000000,
-16304344.000000,
-16315776.000000,
-16315781.000000,
-16333332.000000,
-16333333.000000,
-16341462.000000,
-16346150.000000,
-16349205.000000,
-16363630.000000,
-16363634.000000,
-16379298.000000,
-16382966.000000,
-16388880.000000,
-16393440.000000,
-16400000.000000,
-16415092.000000,
-16428566.000000,
-16428570.000000,
-16440677.000000,
-16444442.000000,
-16451610.000000,
-16458328.000000,
-16470583.000000,
-16470586.000000,
-16481479.000000,
-16486482.000000,
-16491219.000000,
-16499998.000000,
-16500000.000000,
-16507935.000000,
-16511626.000000,
-16521735.000000,
-16530611.000000,
-16538457.000000,
-16545452.000000,
-16557374.000000,
-16562500.000000,
-16571425.000000,
-16578933.000000,
-16585364.000000,
-16590902.000000,
-16595731.000000,
-16600000.000000,
-16603771.000000,
-16607137.000000,
-16610168.000000,
-16612900.000000,
-16666657.000000,
-16666664.000000,
-16666665.000000,
-16666666.000000,
-16721308.000000,
-16724137.000000,
-16727270.000000,
-16730764.000000,
-16734692.000000,
-16739126.000000,
-16744184.000000,
-16750000.000000,
-16756752.000000,
-16764700.000000,
-16774190.000000,
-16779660.000000,
-16785708.000000,
-16792450.000000,
-16800000.000000,
-16808496.000000,
-16818174.000000,
-16825396.000000,
-16829266.000000,
-16833330.000000,
-16851848.000000,
-16857140.000000,
-16862742.000000,
-16875000.000000,
-16885242.000000,
-16888886.000000,
-16896550.000000,
-16896552.000000,
-16904760.000000,
-16909088.000000,
-16923072.000000,
-16923076.000000,
-16935480.000000,
-16938772.000000,
-16944434.000000,
-16949150.000000,
-16956516.000000,
-16964280.000000,
-16969694.000000,
-16976742.000000,
-16981128.000000,
-16984124.000000,
-16999996.000000,
-17000000.000000,
-17017542.000000,
-17027022.000000,
-17037034.000000,
-17045446.000000,
-17049176.000000,
-17058816.000000,
-17058820.000000,
-17068964.000000,
-17073168.000000,
-17083332.000000,
-17090906.000000,
-17096770.000000,
-17105260.000000,
-17111108.000000,
-17115378.000000,
-17118640.000000,
-17142852.000000,
-17142854.000000,
-17142856.000000,
-17166662.000000,
-17169808.000000,
-17173908.000000,
-17179486.000000,
-17187500.000000,
-17192980.000000,
-17200000.000000,
-17209300.000000,
-17213110.000000,
-17222212.000000,
-17222220.000000,
-17234040.000000,
-17241376.000000,
-17241378.000000,
-17250000.000000,
-17254898.000000,
-17258060.000000,
-17272718.000000,
-17272724.000000,
-17288132.000000,
-17291664.000000,
-17301584.000000,
-17307684.000000,
-17317070.000000,
-17321428.000000,
-17333328.000000,
-17333330.000000,
-17333332.000000,
-17346936.000000,
-17352934.000000,
-17358488.000000,
-17368418.000000,
-17377044.000000,
-17380950.000000,
-17400000.000000,
-17407404.000000,
-17413788.000000,
-17419350.000000,
-17428568.000000,
-17435896.000000,
-17441858.000000,
-17446806.000000,
-17450976.000000,
-17457624.000000,
-17460316.000000,
-17499988.000000,
-17499990.000000,
-17499992.000000,
-17499994.000000,
-17499998.000000,
-17500000.000000,
-17540978.000000,
-17543856.000000,
-17547166.000000,
-17551016.000000,
-17555552.000000,
-17560972.000000,
-17567566.000000,
-17575754.000000,
-17580640.000000,
-17586202.000000,
-17586204.000000,
-17592588.000000,
-17600000.000000,
-17608696.000000,
-17619044.000000,
-17627114.000000,
-17631576.000000,
-17636362.000000,
-17647052.000000,
-17647054.000000,
-17659572.000000,
-17666660.000000,
-17666664.000000,
-17674416.000000,
-17678568.000000,
-17692300.000000,
-17692306.000000,
-17704912.000000,
-17708332.000000,
-17714280.000000,
-17719294.000000,
-17727262.000000,
-17735844.000000,
-17741930.000000,
-17750000.000000,
-17755096.000000,
-17758616.000000,
-17796604.000000,
-17800000.000000,
-17804874.000000,
-17812500.000000,
-17818180.000000,
-17826086.000000,
-17833326.000000,
-17837836.000000,
-17843132.000000,
-17857140.000000,
-17868846.000000,
-17872336.000000,
-17878784.000000,
-17884606.000000,
-17894732.000000,
-17903220.000000,
-17906974.000000,
-17916664.000000,
-17924524.000000,
-17931028.000000,
-17931032.000000,
-17941168.000000,
-17948716.000000,
-17954534.000000,
-17959178.000000,
-17962960.000000,
-17966096.000000,
-17999992.000000,
-17999996.000000,
-17999998.000000,
-18000000.000000,
-18032780.000000,
-18035712.000000,
-18039210.000000,
-18043476.000000,
-18048776.000000,
-18055552.000000,
-18064510.000000,
-18070170.000000,
-18076912.000000,
-18085100.000000,
-18095236.000000,
-18103440.000000,
-18108106.000000,
-18124996.000000,
-18125000.000000,
-18135588.000000,
-18139532.000000,
-18148146.000000,
-18157888.000000,
-18163260.000000,
-18166658.000000,
-18181814.000000,
-18181816.000000,
-18196714.000000,
-18200000.000000,
-18205126.000000,
-18214282.000000,
-18222220.000000,
-18235284.000000,
-18235288.000000,
-18245608.000000,
-18250000.000000,
-18260868.000000,
-18269220.000000,
-18275854.000000,
-18275860.000000,
-18292678.000000,
-18297866.000000,
-18301888.000000,
-18305078.000000,
-18333324.000000,
-18333330.000000,
-18333332.000000,
-18363634.000000,
-18367340.000000,
-18372090.000000,
-18378376.000000,
-18387090.000000,
-18392852.000000,
-18400000.000000,
-18409090.000000,
-18421046.000000,
-18431366.000000,
-18437500.000000,
-18444442.000000,
-18448268.000000,
-18461536.000000,
-18474568.000000,
-18478260.000000,
-18484844.000000,
-18490566.000000,
-18499990.000000,
-18500000.000000,
-18510632.000000,
-18518516.000000,
-18529402.000000,
-18536580.000000,
-18541664.000000,
-18545452.000000,
-18571420.000000,
-18571424.000000,
-18571428.000000,
-18596484.000000,
-18600000.000000,
-18611108.000000,
-18620680.000000,
-18620686.000000,
-18627444.000000,
-18636362.000000,
-18644060.000000,
-18648646.000000,
-18653844.000000,
-18666664.000000,
-18679244.000000,
-18684204.000000,
-18695650.000000,
-18703700.000000,
-18709670.000000,
-18717946.000000,
-18723396.000000,
-18727270.000000,
-18749996.000000,
-18750000.000000,
-18771922.000000,
-18775502.000000,
-18780482.000000,
-18787874.000000,
-18793092.000000,
-18800000.000000,
-18809520.000000,
-18813552.000000,
-18837210.000000,
-18846152.000000,
-18857142.000000,
-18863634.000000,
-18867924.000000,
-18888884.000000,
-18888886.000000,
-18909088.000000,
-18913040.000000,
-18918916.000000,
-18928566.000000,
-18936160.000000,
-18947360.000000,
-18958328.000000,
-18965506.000000,
-18965512.000000,
-18974356.000000,
-18979584.000000,
-18999996.000000,
-19000000.000000,
-19019606.000000,
-19024384.000000,
-19032250.000000,
-19038460.000000,
-19056604.000000,
-19062500.000000,
-19069768.000000,
-19074072.000000,
-19090904.000000,
-19090906.000000,
-19107136.000000,
-19111108.000000,
-19117644.000000,
-19122798.000000,
-19130432.000000,
-19137920.000000,
-19142856.000000,
-19148926.000000,
-19166660.000000,
-19166662.000000,
-19183664.000000,
-19189186.000000,
-19210516.000000,
-19215684.000000,
-19230766.000000,
-19230768.000000,
-19245282.000000,
-19250000.000000,
-19259256.000000,
-19268286.000000,
-19272724.000000,
-19285708.000000,
-19285716.000000,
-19298236.000000,
-19302326.000000,
-19310340.000000,
-19318178.000000,
-19333330.000000,
-19347824.000000,
-19354830.000000,
-19361692.000000,
-19374996.000000,
-19375000.000000,
-19387744.000000,
-19400000.000000,
-19411762.000000,
-19423072.000000,
-19428570.000000,
-19433960.000000,
-19444438.000000,
-19444440.000000,
-19454542.000000,
-19459456.000000,
-19464280.000000,
-19473674.000000,
-19487176.000000,
-19500000.000000,
-19523810.000000,
-19534884.000000,
-19545450.000000,
-19555552.000000,
-19565214.000000,
-19574456.000000,
-19583328.000000,
-19600000.000000,
-19607840.000000,
-19615380.000000,
-19615384.000000,
-19622640.000000,
-19629626.000000,
-19636360.000000,
-19642850.000000,
-19655168.000000,
-19666664.000000,
-19677410.000000,
-19687500.000000,
-19696970.000000,
-19705880.000000,
-19714284.000000,
-19722216.000000,
-19729726.000000,
-19736832.000000,
-19743586.000000,
-19750000.000000,
-19756098.000000,
-19761904.000000,
-19767442.000000,
-19772722.000000,
-19777774.000000,
-19782604.000000,
-19787220.000000,
-19791660.000000,
-19795916.000000,
-19800000.000000,
-19803918.000000,
-19807688.000000,
-19811320.000000,
-19814812.000000,
-19818178.000000,
-19821420.000000,
-19999986.000000,
-19999988.000000,
-19999990.000000,
-19999992.000000,
-19999994.000000,
-19999996.000000,
-19999998.000000,
-20000000.000000,
-20181814.000000,
-20185180.000000,
-20188676.000000,
-20192300.000000,
-20196074.000000,
-20200000.000000,
-20204080.000000,
-20208332.000000,
-20212752.000000,
-20217388.000000,
-20222218.000000,
-20227266.000000,
-20232558.000000,
-20238096.000000,
-20243902.000000,
-20250000.000000,
-20256406.000000,
-20263144.000000,
-20270266.000000,
-20277768.000000,
-20285712.000000,
-20294112.000000,
-20303030.000000,
-20312500.000000,
-20322570.000000,
-20333328.000000,
-20344820.000000,
-20357134.000000,
-20370366.000000,
-20377356.000000,
-20384608.000000,
-20384612.000000,
-20392152.000000,
-20400000.000000,
-20408160.000000,
-20416666.000000,
-20434778.000000,
-20444440.000000,
-20454538.000000,
-20465116.000000,
-20476190.000000,
-20487804.000000,
-20500000.000000,
-20526302.000000,
-20540536.000000,
-20555546.000000,
-20555552.000000,
-20566036.000000,
-20571426.000000,
-20576916.000000,
-20588230.000000,
-20600000.000000,
-20606060.000000,
-20612240.000000,
-20625000.000000,
-20638296.000000,
-20652168.000000,
-20666662.000000,
-20681810.000000,
-20689648.000000,
-20697674.000000,
-20714276.000000,
-20714284.000000,
-20731706.000000,
-20740736.000000,
-20750000.000000,
-20754714.000000,
-20769222.000000,
-20769228.000000,
-20769230.000000,
-20784308.000000,
-20789460.000000,
-20800000.000000,
-20810806.000000,
-20816322.000000,
-20833324.000000,
-20833332.000000,
-20851062.000000,
-20857140.000000,
-20882348.000000,
-20888884.000000,
-20909082.000000,
-20909090.000000,
-20930232.000000,
-20937500.000000,
-20943392.000000,
-20952380.000000,
-20961528.000000,
-20967740.000000,
-20975608.000000,
-20980386.000000,
-20999996.000000,
-21000000.000000,
-21020404.000000,
-21025640.000000,
-21034476.000000,
-21041664.000000,
-21063828.000000,
-21071418.000000,
-21081076.000000,
-21086956.000000,
-21111100.000000,
-21111106.000000,
-21136354.000000,
-21142854.000000,
-21153836.000000,
-21153844.000000,
-21162790.000000,
-21176464.000000,
-21190476.000000,
-21200000.000000,
-21212120.000000,
-21219510.000000,
-21224484.000000,
-21249998.000000,
-21250000.000000,
-21276592.000000,
-21282050.000000,
-21290320.000000,
-21304346.000000,
-21315788.000000,
-21346144.000000,
-21351346.000000,
-21363626.000000,
-21372542.000000,
-21379302.000000,
-21388876.000000,
-21395348.000000,
-21400000.000000,
-21428560.000000,
-21428564.000000,
-21428568.000000,
-21428570.000000,
-21458332.000000,
-21463412.000000,
-21470580.000000,
-21481476.000000,
-21489356.000000,
-21500000.000000,
-21515150.000000,
-21521736.000000,
-21538458.000000,
-21538460.000000,
-21555554.000000,
-21562500.000000,
-21568620.000000,
-21578946.000000,
-21590898.000000,
-21600000.000000,
-21612900.000000,
-21627906.000000,
-21632646.000000,
-21666654.000000,
-21666664.000000,
-21702122.000000,
-21707314.000000,
-21714282.000000,
-21724128.000000,
-21739128.000000,
-21750000.000000,
-21764698.000000,
-21777776.000000,
-21785702.000000,
-21794870.000000,
-21800000.000000,
-21818180.000000,
-21836728.000000,
-21842104.000000,
-21851846.000000,
-21860464.000000,
-21874996.000000,
-21875000.000000,
-21891890.000000,
-21904760.000000,
-21914888.000000,
-21923072.000000,
-21935480.000000,
-21944432.000000,
-21951216.000000,
-21956520.000000,
-21999996.000000,
-21999998.000000,
-22000000.000000,
-22040808.000000,
-22045452.000000,
-22051280.000000,
-22058816.000000,
-22083330.000000,
-22093022.000000,
-22105260.000000,
-22121210.000000,
-22127652.000000,
-22142844.000000,
-22142856.000000,
-22162160.000000,
-22173910.000000,
-22187500.000000,
-22195118.000000,
-22200000.000000,
-22222216.000000,
-22222220.000000,
-22244888.000000,
-22250000.000000,
-22258060.000000,
-22272724.000000,
-22285710.000000,
-22291664.000000,
-22307688.000000,
-22307690.000000,
-22333332.000000,
-22340416.000000,
-22352932.000000,
-22368416.000000,
-22380950.000000,
-22391300.000000,
-22400000.000000,
-22413792.000000,
-22424240.000000,
-22432430.000000,
-22439020.000000,
-22444442.000000,
-22448970.000000,
-22499986.000000,
-22499996.000000,
-22500000.000000,
-22553182.000000,
-22558138.000000,
-22564100.000000,
-22571424.000000,
-22580640.000000,
-22592586.000000,
-22608692.000000,
-22619044.000000,
-22631574.000000,
-22647048.000000,
-22653052.000000,
-22666664.000000,
-22682922.000000,
-22692304.000000,
-22702700.000000,
-22708328.000000,
-22727268.000000,
-22727270.000000,
-22750000.000000,
-22758618.000000,
-22765948.000000,
-22777776.000000,
-22790696.000000,
-22800000.000000,
-22812500.000000,
-22820510.000000,
-22826084.000000,
-22888886.000000,
-22894732.000000,
-22903220.000000,
-22916662.000000,
-22926824.000000,
-22941166.000000,
-22954540.000000,
-22962956.000000,
-22972970.000000,
-22978712.000000,
-22999996.000000,
-23000000.000000,
-23023254.000000,
-23030300.000000,
-23043474.000000,
-23055552.000000,
-23076918.000000,
-23076920.000000,
-23095236.000000,
-23103444.000000,
-23111108.000000,
-23124996.000000,
-23125000.000000,
-23142856.000000,
-23157888.000000,
-23170726.000000,
-23181812.000000,
-23181816.000000,
-23191476.000000,
-23200000.000000,
-23214284.000000,
-23225800.000000,
-23235284.000000,
-23243240.000000,
-23250000.000000,
-23255812.000000,
-23260864.000000,
-23333326.000000,
-23333328.000000,
-23333330.000000,
-23333332.000000,
-23404242.000000,
-23409084.000000,
-23421044.000000,
-23428570.000000,
-23437500.000000,
-23448272.000000,
-23461532.000000,
-23478256.000000,
-23488370.000000,
-23500000.000000,
-23513510.000000,
-23548380.000000,
-23555552.000000,
-23571426.000000,
-23571428.000000,
-23589740.000000,
-23600000.000000,
-23611108.000000,
-23617008.000000,
-23636356.000000,
-23636360.000000,
-23658536.000000,
-23666664.000000,
-23684202.000000,
-23695648.000000,
-23714284.000000,
-23720928.000000,
-23749994.000000,
-23750000.000000,
-23777774.000000,
-23783780.000000,
-23793100.000000,
-23809522.000000,
-23823528.000000,
-23846148.000000,
-23846150.000000,
-23863628.000000,
-23870960.000000,
-23888884.000000,
-23902438.000000,
-23913038.000000,
-23928568.000000,
-23939390.000000,
-23947360.000000,
-23953486.000000,
-23999996.000000,
-23999998.000000,
-24000000.000000,
-24047616.000000,
-24054050.000000,
-24062500.000000,
-24074074.000000,
-24090900.000000,
-24090904.000000,
-24102560.000000,
-24117646.000000,
-24130428.000000,
-24137926.000000,
-24146340.000000,
-24166660.000000,
-24186044.000000,
-24193540.000000,
-24210516.000000,
-24222218.000000,
-24230764.000000,
-24250000.000000,
-24285710.000000,
-24285712.000000,
-24318172.000000,
-24324320.000000,
-24333328.000000,
-24347820.000000,
-24358970.000000,
-24375000.000000,
-24390242.000000,
-24400000.000000,
-24411764.000000,
-24418602.000000,
-24444438.000000,
-24444440.000000,
-24444444.000000,
-24473672.000000,
-24482752.000000,
-24500000.000000,
-24516120.000000,
-24523808.000000,
-24545444.000000,
-24545450.000000,
-24545454.000000,
-24571426.000000,
-24583326.000000,
-24594590.000000,
-24634144.000000,
-24642852.000000,
-24651160.000000,
-24666662.000000,
-24687500.000000,
-24705880.000000,
-24722216.000000,
-24736830.000000,
-24750000.000000,
-24761902.000000,
-24772716.000000,
-24782602.000000,
-24800000.000000,
-24814814.000000,
-24827580.000000,
-24838700.000000,
-24848484.000000,
-24857140.000000,
-24864860.000000,
-24871794.000000,
-24878046.000000,
-24883718.000000,
-24999988.000000,
-24999992.000000,
-24999994.000000,
-24999996.000000,
-25000000.000000,
-25116276.000000,
-25121948.000000,
-25128204.000000,
-25135130.000000,
-25142854.000000,
-25151514.000000,
-25161280.000000,
-25172408.000000,
-25185184.000000,
-25200000.000000,
-25217384.000000,
-25227260.000000,
-25238092.000000,
-25250000.000000,
-25277768.000000,
-25294114.000000,
-25312500.000000,
-25333328.000000,
-25348834.000000,
-25357136.000000,
-25365850.000000,
-25384614.000000,
-25405400.000000,
-25416658.000000,
-25428568.000000,
-25454540.000000,
-25454544.000000,
-25476188.000000,
-25483860.000000,
-25500000.000000,
-25517234.000000,
-25526312.000000,
-25555546.000000,
-25555554.000000,
-25581392.000000,
-25588232.000000,
-25609752.000000,
-25625000.000000,
-25641024.000000,
-25652166.000000,
-25666660.000000,
-25675670.000000,
-25714278.000000,
-25714282.000000,
-25750000.000000,
-25757574.000000,
-25769228.000000,
-25789470.000000,
-25789472.000000,
-25813950.000000,
-25833324.000000,
-25853654.000000,
-25862060.000000,
-25882348.000000,
-25897434.000000,
-25909084.000000,
-25925924.000000,
-25937500.000000,
-25952376.000000,
-25999994.000000,
-25999996.000000,
-26000000.000000,
-26052628.000000,
-26060604.000000,
-26071420.000000,
-26086948.000000,
-26097556.000000,
-26111100.000000,
-26129032.000000,
-26153844.000000,
-26176464.000000,
-26190472.000000,
-26206888.000000,
-26216214.000000,
-26249990.000000,
-26250000.000000,
-26285710.000000,
-26296294.000000,
-26315784.000000,
-26315786.000000,
-26333328.000000,
-26341458.000000,
-26363630.000000,
-26363634.000000,
-26388876.000000,
-26400000.000000,
-26410254.000000,
-26428562.000000,
-26428568.000000,
-26451612.000000,
-26470582.000000,
-26486484.000000,
-26500000.000000,
-26521730.000000,
-26538460.000000,
-26551716.000000,
-26562500.000000,
-26571424.000000,
-26578940.000000,
-26585360.000000,
-26666662.000000,
-26666664.000000,
-26750000.000000,
-26756754.000000,
-26764700.000000,
-26774192.000000,
-26785704.000000,
-26800000.000000,
-26818176.000000,
-26829262.000000,
-26842098.000000,
-26842100.000000,
-26857138.000000,
-26875000.000000,
-26896542.000000,
-26923074.000000,
-26944444.000000,
-26956512.000000,
-26969694.000000,
-27000000.000000,
-27027024.000000,
-27037034.000000,
-27058816.000000,
-27073164.000000,
-27083332.000000,
-27096772.000000,
-27105256.000000,
-27142846.000000,
-27142852.000000,
-27179484.000000,
-27187500.000000,
-27200000.000000,
-27222220.000000,
-27241368.000000,
-27250000.000000,
-27272720.000000,
-27272724.000000,
-27297294.000000,
-27307688.000000,
-27333332.000000,
-27352932.000000,
-27368412.000000,
-27368416.000000,
-27391294.000000,
-27407404.000000,
-27419352.000000,
-27435894.000000,
-27499988.000000,
-27499996.000000,
-27499998.000000,
-27500000.000000,
-27567564.000000,
-27575754.000000,
-27600000.000000,
-27619042.000000,
-27631568.000000,
-27647050.000000,
-27666664.000000,
-27692304.000000,
-27714286.000000,
-27727264.000000,
-27741932.000000,
-27750000.000000,
-27777774.000000,
-27777776.000000,
-27812500.000000,
-27837834.000000,
-27857130.000000,
-27878784.000000,
-27894726.000000,
-27894732.000000,
-27916664.000000,
-27931032.000000,
-27941168.000000,
-27948714.000000,
-27999998.000000,
-28000000.000000,
-28055552.000000,
-28064512.000000,
-28076920.000000,
-28095232.000000,
-28108104.000000,
-28125000.000000,
-28148144.000000,
-28157884.000000,
-28181810.000000,
-28181814.000000,
-28205124.000000,
-28214272.000000,
-28260868.000000,
-28275860.000000,
-28285714.000000,
-28333328.000000,
-28333330.000000,
-28333332.000000,
-28378374.000000,
-28387092.000000,
-28400000.000000,
-28421040.000000,
-28421046.000000,
-28437500.000000,
-28461534.000000,
-28484844.000000,
-28500000.000000,
-28518514.000000,
-28529412.000000,
-28571422.000000,
-28571428.000000,
-28611104.000000,
-28620688.000000,
-28636356.000000,
-28648644.000000,
-28666664.000000,
-28684196.000000,
-28695650.000000,
-28709672.000000,
-28749996.000000,
-28750000.000000,
-28787874.000000,
-28800000.000000,
-28823528.000000,
-28846148.000000,
-28857142.000000,
-28888882.000000,
-28888884.000000,
-28888886.000000,
-28918914.000000,
-28928570.000000,
-28947354.000000,
-28947360.000000,
-28965514.000000,
-28999996.000000,
-29000000.000000,
-29032252.000000,
-29047612.000000,
-29062500.000000,
-29117644.000000,
-29130432.000000,
-29142856.000000,
-29166660.000000,
-29166662.000000,
-29189184.000000,
-29200000.000000,
-29210512.000000,
-29230764.000000,
-29259254.000000,
-29285712.000000,
-29310340.000000,
-29333330.000000,
-29354832.000000,
-29375000.000000,
-29393938.000000,
-29411762.000000,
-29411764.000000,
-29428570.000000,
-29444436.000000,
-29444440.000000,
-29459454.000000,
-29473676.000000,
-29500000.000000,
-29523802.000000,
-29545452.000000,
-29565214.000000,
-29583328.000000,
-29600000.000000,
-29615380.000000,
-29642854.000000,
-29655168.000000,
-29666664.000000,
-29677412.000000,
-29687500.000000,
-29696968.000000,
-29705880.000000,
-29714284.000000,
-29722212.000000,
-29729724.000000,
-29999990.000000,
-29999992.000000,
-29999994.000000,
-29999996.000000,
-29999998.000000,
-30000000.000000,
-30277768.000000,
-30285712.000000,
-30294112.000000,
-30303028.000000,
-30312500.000000,
-30322572.000000,
-30333328.000000,
-30344822.000000,
-30357138.000000,
-30370368.000000,
-30384608.000000,
-30400000.000000,
-30416660.000000,
-30434778.000000,
-30454544.000000,
-30500000.000000,
-30526306.000000,
-30555544.000000,
-30555552.000000,
-30571426.000000,
-30588230.000000,
-30588234.000000,
-30606058.000000,
-30625000.000000,
-30645152.000000,
-30666662.000000,
-30689648.000000,
-30714280.000000,
-30740738.000000,
-30800000.000000,
-30833320.000000,
-30833326.000000,
-30857140.000000,
-30869560.000000,
-30882348.000000,
-30909088.000000,
-30937500.000000,
-30952380.000000,
-30999996.000000,
-31000000.000000,
-31034476.000000,
-31052620.000000,
-31071422.000000,
-31111106.000000,
-31111108.000000,
-31142854.000000,
-31153844.000000,
-31176464.000000,
-31176468.000000,
-31200000.000000,
-31212118.000000,
-31249992.000000,
-31250000.000000,
-31290320.000000,
-31304342.000000,
-31333328.000000,
-31363632.000000,
-31379304.000000,
-31428564.000000,
-31428568.000000,
-31428570.000000,
-31470580.000000,
-31481478.000000,
-31500000.000000,
-31515148.000000,
-31538460.000000,
-31562500.000000,
-31578936.000000,
-31600000.000000,
-31612900.000000,
-31666658.000000,
-31666660.000000,
-31714282.000000,
-31724130.000000,
-31739124.000000,
-31764698.000000,
-31764704.000000,
-31785706.000000,
-31818178.000000,
-31851848.000000,
-31875000.000000,
-31904760.000000,
-31923076.000000,
-31935480.000000,
-32058816.000000,
-32068956.000000,
-32083324.000000,
-32105252.000000,
-32121208.000000,
-32142848.000000,
-32173906.000000,
-32187500.000000,
-32222216.000000,
-32222218.000000,
-32258060.000000,
-32272724.000000,
-32307690.000000,
-32333332.000000,
-32352932.000000,
-32352940.000000,
-32380950.000000,
-32400000.000000,
-32413784.000000,
-32424238.000000,
-32499990.000000,
-32500000.000000,
-32580640.000000,
-32592588.000000,
-32608688.000000,
-32631566.000000,
-32647048.000000,
-32666666.000000,
-32692304.000000,
-32727268.000000,
-32758612.000000,
-32777772.000000,
-32800000.000000,
-32812500.000000,
-32857132.000000,
-32857140.000000,
-32903220.000000,
-32916656.000000,
-32941174.000000,
-32962958.000000,
-33000000.000000,
-33030298.000000,
-33043470.000000,
-33076920.000000,
-33125000.000000,
-33157880.000000,
-33181812.000000,
-33200000.000000,
-33214274.000000,
-33225800.000000,
-33333326.000000,
-33333328.000000,
-33333330.000000,
-33333332.000000,
-33437500.000000,
-33448276.000000,
-33461536.000000,
-33478252.000000,
-33500000.000000,
-33529408.000000,
-33548380.000000,
-33571416.000000,
-33600000.000000,
-33636360.000000,
-33666664.000000,
-33703696.000000,
-33750000.000000,
-33793104.000000,
-33809520.000000,
-33846152.000000,
-33870960.000000,
-33888880.000000,
-33913032.000000,
-33928560.000000,
-34000000.000000,
-34062500.000000,
-34074068.000000,
-34090904.000000,
-34117644.000000,
-34137928.000000,
-34166664.000000,
-34193540.000000,
-34210524.000000,
-34230764.000000,
-34285712.000000,
-34333332.000000,
-34347816.000000,
-34375000.000000,
-34400000.000000,
-34444436.000000,
-34444440.000000,
-34482756.000000,
-34500000.000000,
-34516120.000000,
-34545448.000000,
-34583328.000000,
-34615380.000000,
-34642856.000000,
-34666664.000000,
-34687500.000000,
-34705880.000000,
-34736840.000000,
-34761900.000000,
-34800000.000000,
-34814808.000000,
-34827584.000000,
-34838700.000000,
-34999992.000000,
-34999996.000000,
-35000000.000000,
-35161280.000000,
-35172408.000000,
-35185176.000000,
-35200000.000000,
-35217392.000000,
-35238088.000000,
-35263152.000000,
-35294112.000000,
-35333328.000000,
-35357136.000000,
-35384608.000000,
-35416664.000000,
-35454536.000000,
-35483860.000000,
-35500000.000000,
-35517236.000000,
-35600000.000000,
-35625000.000000,
-35652172.000000,
-35666664.000000,
-35714280.000000,
-35769224.000000,
-35789468.000000,
-35806440.000000,
-35833328.000000,
-35862064.000000,
-35882348.000000,
-35909084.000000,
-35925928.000000,
-35999996.000000,
-36000000.000000,
-36071424.000000,
-36086952.000000,
-36111112.000000,
-36153840.000000,
-36190472.000000,
-36206892.000000,
-36249992.000000,
-36250000.000000,
-36296296.000000,
-36315784.000000,
-36333328.000000,
-36400000.000000,
-36428564.000000,
-36428568.000000,
-36470584.000000,
-36500000.000000,
-36521736.000000,
-36538456.000000,
-36551720.000000,
-36666660.000000,
-36666664.000000,
-36785704.000000,
-36800000.000000,
-36818180.000000,
-36842096.000000,
-36875000.000000,
-36896544.000000,
-36956520.000000,
-36999996.000000,
-37000000.000000,
-37037036.000000,
-37058820.000000,
-37083328.000000,
-37142848.000000,
-37142852.000000,
-37200000.000000,
-37222220.000000,
-37241372.000000,
-37272728.000000,
-37307692.000000,
-37333328.000000,
-37368412.000000,
-37391300.000000,
-37407408.000000,
-37499992.000000,
-37500000.000000,
-37586200.000000,
-37600000.000000,
-37619040.000000,
-37692304.000000,
-37727272.000000,
-37777776.000000,
-37826080.000000,
-37857132.000000,
-37857136.000000,
-37894728.000000,
-37916656.000000,
-37931024.000000,
-37999992.000000,
-38000000.000000,
-38076920.000000,
-38125000.000000,
-38148144.000000,
-38181816.000000,
-38214272.000000,
-38235292.000000,
-38260864.000000,
-38275852.000000,
-38333324.000000,
-38333332.000000,
-38421044.000000,
-38461536.000000,
-38500000.000000,
-38518516.000000,
-38571416.000000,
-38571424.000000,
-38571432.000000,
-38636360.000000,
-38666660.000000,
-38695648.000000,
-38749992.000000,
-38750000.000000,
-38800000.000000,
-38823528.000000,
-38846152.000000,
-38888888.000000,
-38928560.000000,
-38947360.000000,
-39000000.000000,
-39047620.000000,
-39090904.000000,
-39130428.000000,
-39166656.000000,
-39200000.000000,
-39230768.000000,
-39259256.000000,
-39285700.000000,
-39285708.000000,
-39333328.000000,
-39375000.000000,
-39411760.000000,
-39444440.000000,
-39473672.000000,
-39500000.000000,
-39523808.000000,
-39545452.000000,
-39565208.000000,
-39583320.000000,
-39600000.000000,
-39615380.000000,
-39629624.000000,
-39642840.000000,
-39999988.000000,
-39999992.000000,
-39999996.000000,
-40000000.000000,
-40370368.000000,
-40384612.000000,
-40400000.000000,
-40416664.000000,
-40434776.000000,
-40454540.000000,
-40476192.000000,
-40500000.000000,
-40526304.000000,
-40555552.000000,
-40588232.000000,
-40625000.000000,
-40666656.000000,
-40714276.000000,
-40740736.000000,
-40769224.000000,
-40800000.000000,
-40833332.000000,
-40869556.000000,
-40909088.000000,
-40952380.000000,
-41000000.000000,
-41052616.000000,
-41111104.000000,
-41153840.000000,
-41176464.000000,
-41200000.000000,
-41250000.000000,
-41304336.000000,
-41333324.000000,
-41363632.000000,
-41428560.000000,
-41428568.000000,
-41500000.000000,
-41538456.000000,
-41578932.000000,
-41600000.000000,
-41666660.000000,
-41666664.000000,
-41764700.000000,
-41818176.000000,
-41875000.000000,
-41904760.000000,
-41923072.000000,
-41999992.000000,
-42000000.000000,
-42083328.000000,
-42142848.000000,
-42173912.000000,
-42222216.000000,
-42272720.000000,
-42307688.000000,
-42352936.000000,
-42380952.000000,
-42400000.000000,
-42499996.000000,
-42500000.000000,
-42608692.000000,
-42631580.000000,
-42692300.000000,
-42727264.000000,
-42777772.000000,
-42800000.000000,
-42857132.000000,
-42857140.000000,
-42916664.000000,
-42941172.000000,
-43000000.000000,
-43043472.000000,
-43076916.000000,
-43125000.000000,
-43157896.000000,
-43181812.000000,
-43200000.000000,
-43333328.000000,
-43333332.000000,
-43478256.000000,
-43500000.000000,
-43529408.000000,
-43571416.000000,
-43600000.000000,
-43684208.000000,
-43749992.000000,
-43750000.000000,
-43809520.000000,
-43846144.000000,
-43888880.000000,
-43913040.000000,
-43999996.000000,
-44000000.000000,
-44090908.000000,
-44117640.000000,
-44166660.000000,
-44166664.000000,
-44210524.000000,
-44285704.000000,
-44285712.000000,
-44347820.000000,
-44375000.000000,
-44400000.000000,
-44500000.000000,
-44545456.000000,
-44583328.000000,
-44615376.000000,
-44666664.000000,
-44705876.000000,
-44736840.000000,
-44761900.000000,
-44782600.000000,
-44999988.000000,
-44999992.000000,
-45000000.000000,
-45217384.000000,
-45238088.000000,
-45263152.000000,
-45294112.000000,
-45333328.000000,
-45384608.000000,
-45416656.000000,
-45454544.000000,
-45500000.000000,
-45555552.000000,
-45625000.000000,
-45652168.000000,
-45789468.000000,
-45833324.000000,
-45833332.000000,
-45882344.000000,
-45909088.000000,
-45999992.000000,
-46000000.000000,
-46086948.000000,
-46111108.000000,
-46153836.000000,
-46190472.000000,
-46249992.000000,
-46250000.000000,
-46315784.000000,
-46363632.000000,
-46428568.000000,
-46470580.000000,
-46500000.000000,
-46521728.000000,
-46666660.000000,
-46666664.000000,
-46818180.000000,
-46842100.000000,
-46875000.000000,
-46923064.000000,
-46956512.000000,
-47000000.000000,
-47142856.000000,
-47222220.000000,
-47272724.000000,
-47333328.000000,
-47368416.000000,
-47391296.000000,
-47499996.000000,
-47500000.000000,
-47619044.000000,
-47647060.000000,
-47692296.000000,
-47727268.000000,
-47777776.000000,
-47826076.000000,
-47857140.000000,
-47894728.000000,
-47999992.000000,
-48095232.000000,
-48125000.000000,
-48181816.000000,
-48235296.000000,
-48260856.000000,
-48333328.000000,
-48421044.000000,
-48461528.000000,
-48500000.000000,
-48571424.000000,
-48636360.000000,
-48666656.000000,
-48750000.000000,
-48823528.000000,
-48888884.000000,
-48947360.000000,
-49000000.000000,
-49047616.000000,
-49090904.000000,
-49166664.000000,
-49285708.000000,
-49333324.000000,
-49375000.000000,
-49411764.000000,
-49444440.000000,
-49473672.000000,
-49500000.000000,
-49523804.000000,
-49545448.000000,
-49999988.000000,
-49999992.000000,
-49999996.000000,
-50000000.000000,
-50454540.000000,
-50476184.000000,
-50500000.000000,
-50555548.000000,
-50588232.000000,
-50625000.000000,
-50666656.000000,
-50714280.000000,
-50769228.000000,
-50833328.000000,
-50909084.000000,
-50952376.000000,
-51000000.000000,
-51052632.000000,
-51111104.000000,
-51176468.000000,
-51250000.000000,
-51333320.000000,
-51428564.000000,
-51500000.000000,
-51538456.000000,
-51578944.000000,
-51666660.000000,
-51666664.000000,
-51764704.000000,
-51818176.000000,
-51875000.000000,
-51904752.000000,
-51999988.000000,
-52000000.000000,
-52105260.000000,
-52142848.000000,
-52222216.000000,
-52307688.000000,
-52352940.000000,
-52380944.000000,
-52499996.000000,
-52500000.000000,
-52631576.000000,
-52666656.000000,
-52727264.000000,
-52777768.000000,
-52857136.000000,
-52941176.000000,
-53000000.000000,
-53076920.000000,
-53125000.000000,
-53157892.000000,
-53500000.000000,
-53529408.000000,
-53571420.000000,
-53636352.000000,
-53684208.000000,
-53750000.000000,
-53846148.000000,
-53888888.000000,
-54000000.000000,
-54117644.000000,
-54166664.000000,
-54210520.000000,
-54285704.000000,
-54375000.000000,
-54444440.000000,
-54444444.000000,
-54500000.000000,
-54545444.000000,
-54615376.000000,
-54666664.000000,
-54705880.000000,
-54736836.000000,
-54999988.000000,
-54999996.000000,
-55000000.000000,
-55263152.000000,
-55294112.000000,
-55333328.000000,
-55384608.000000,
-55454536.000000,
-55500000.000000,
-55555552.000000,
-55625000.000000,
-55714272.000000,
-55789464.000000,
-55833332.000000,
-55882348.000000,
-55999996.000000,
-56000000.000000,
-56111108.000000,
-56153840.000000,
-56250000.000000,
-56315780.000000,
-56363624.000000,
-56428560.000000,
-56666664.000000,
-56842096.000000,
-56875000.000000,
-56923068.000000,
-57000000.000000,
-57058824.000000,
-57222216.000000,
-57272712.000000,
-57333328.000000,
-57368412.000000,
-57499996.000000,
-57500000.000000,
-57647056.000000,
-57692296.000000,
-57777772.000000,
-57777776.000000,
-57857140.000000,
-57894728.000000,
-57999992.000000,
-58000000.000000,
-58125000.000000,
-58235292.000000,
-58333328.000000,
-58421040.000000,
-58461528.000000,
-58571424.000000,
-58666660.000000,
-58750000.000000,
-58823528.000000,
-58888880.000000,
-58888888.000000,
-59000000.000000,
-59090904.000000,
-59166664.000000,
-59230760.000000,
-59285712.000000,
-59333328.000000,
-59375000.000000,
-59411764.000000,
-59444436.000000,
-59999988.000000,
-59999992.000000,
-59999996.000000,
-60000000.000000,
-60555548.000000,
-60588232.000000,
-60625000.000000,
-60666656.000000,
-60714280.000000,
-60769216.000000,
-60833328.000000,
-60909088.000000,
-61000000.000000,
-61111104.000000,
-61111108.000000,
-61176468.000000,
-61250000.000000,
-61333324.000000,
-61428568.000000,
-61666656.000000,
-61666664.000000,
-61764704.000000,
-61818176.000000,
-61875000.000000,
-61999992.000000,
-62000000.000000,
-62142852.000000,
-62222220.000000,
-62307688.000000,
-62352936.000000,
-62499996.000000,
-62500000.000000,
-62666656.000000,
-62727264.000000,
-62857136.000000,
-62941172.000000,
-63000000.000000,
-63076920.000000,
-63125000.000000,
-63333320.000000,
-63333328.000000,
-63333332.000000,
-63529408.000000,
-63571420.000000,
-63636356.000000,
-63750000.000000,
-63846152.000000,
-64117644.000000,
-64166660.000000,
-64285704.000000,
-64375000.000000,
-64444440.000000,
-64545448.000000,
-64615380.000000,
-64666664.000000,
-64705880.000000,
-64999992.000000,
-65000000.000000,
-65294112.000000,
-65333332.000000,
-65384608.000000,
-65454536.000000,
-65555552.000000,
-65625000.000000,
-65714276.000000,
-65833328.000000,
-66000000.000000,
-66153840.000000,
-66250000.000000,
-66363624.000000,
-66428560.000000,
-66666664.000000,
-66875000.000000,
-66923072.000000,
-67000000.000000,
-67142848.000000,
-67272720.000000,
-67333328.000000,
-67500000.000000,
-67692304.000000,
-67777776.000000,
-67857128.000000,
-68000000.000000,
-68125000.000000,
-68181808.000000,
-68333328.000000,
-68461528.000000,
-68666664.000000,
-68750000.000000,
-68888888.000000,
-69000000.000000,
-69090896.000000,
-69166664.000000,
-69230760.000000,
-69285712.000000,
-69333328.000000,
-69375000.000000,
-69999984.000000,
-69999992.000000,
-70000000.000000,
-70666656.000000,
-70714280.000000,
-70769216.000000,
-70833328.000000,
-70909072.000000,
-71000000.000000,
-71250000.000000,
-71333328.000000,
-71428560.000000,
-71428568.000000,
-71538448.000000,
-71666664.000000,
-71818168.000000,
-71999992.000000,
-72000000.000000,
-72142848.000000,
-72222224.000000,
-72307680.000000,
-72499992.000000,
-72500000.000000,
-72666656.000000,
-72857136.000000,
-73000000.000000,
-73076912.000000,
-73333328.000000,
-73333336.000000,
-73571416.000000,
-73636360.000000,
-73750000.000000,
-73999992.000000,
-74000000.000000,
-74166664.000000,
-74285704.000000,
-74285712.000000,
-74444448.000000,
-74545456.000000,
-74615384.000000,
-74999992.000000,
-75000000.000000,
-75384608.000000,
-75454544.000000,
-75555552.000000,
-75714272.000000,
-75714280.000000,
-75833328.000000,
-76000000.000000,
-76153840.000000,
-76250000.000000,
-76363632.000000,
-76428560.000000,
-76666656.000000,
-76666664.000000,
-76923072.000000,
-77000000.000000,
-77142848.000000,
-77272720.000000,
-77499992.000000,
-77500000.000000,
-77692304.000000,
-77777776.000000,
-77857128.000000,
-78000000.000000,
-78181808.000000,
-78333328.000000,
-78461536.000000,
-78571416.000000,
-78571424.000000,
-78750000.000000,
-78888888.000000,
-79000000.000000,
-79090904.000000,
-79166656.000000,
-79230760.000000,
-79285696.000000,
-79999992.000000,
-80000000.000000,
-80769224.000000,
-80833336.000000,
-80909080.000000,
-81000000.000000,
-81111112.000000,
-81250000.000000,
-81428560.000000,
-81538448.000000,
-81666664.000000,
-81818176.000000,
-82000000.000000,
-82222224.000000,
-82307680.000000,
-82500000.000000,
-82727264.000000,
-82857136.000000,
-83000000.000000,
-83076912.000000,
-83333328.000000,
-83333336.000000,
-83636352.000000,
-83750000.000000,
-83846144.000000,
-84000000.000000,
-84166664.000000,
-84285704.000000,
-84444448.000000,
-84545440.000000,
-84615376.000000,
-85000000.000000,
-85384600.000000,
-85454528.000000,
-85555552.000000,
-85714272.000000,
-85833328.000000,
-86000000.000000,
-86250000.000000,
-86363624.000000,
-86666664.000000,
-87000000.000000,
-87142848.000000,
-87500000.000000,
-87777776.000000,
-88000000.000000,
-88181816.000000,
-88333328.000000,
-88571416.000000,
-88750000.000000,
-89000000.000000,
-89090912.000000,
-89166664.000000,
-89999984.000000,
-90000000.000000,
-90833328.000000,
-90909088.000000,
-91000000.000000,
-91111112.000000,
-91250000.000000,
-91666664.000000,
-91818176.000000,
-92000000.000000,
-92222224.000000,
-92499992.000000,
-92500000.000000,
-92727264.000000,
-92857136.000000,
-93000000.000000,
-93333328.000000,
-93636360.000000,
-93750000.000000,
-94000000.000000,
-94285712.000000,
-94444440.000000,
-94545448.000000,
-94999992.000000,
-95000000.000000,
-95454536.000000,
-95555552.000000,
-95714280.000000,
-96250000.000000,
-96363632.000000,
-96666656.000000,
-96666664.000000,
-97000000.000000,
-97142848.000000,
-97272720.000000,
-97500000.000000,
-97777776.000000,
-98000000.000000,
-98181808.000000,
-98333328.000000,
-98571424.000000,
-98750000.000000,
-98888888.000000,
-99000000.000000,
-99090896.000000,
-99999984.000000,
-99999992.000000,
-100000000.000000,
-100909080.000000,
-101000000.000000,
-101111112.000000,
-101250000.000000,
-101428568.000000,
-101666656.000000,
-102000000.000000,
-102222224.000000,
-102500000.000000,
-102857136.000000,
-103000000.000000,
-103333328.000000,
-103750000.000000,
-104000000.000000,
-104285704.000000,
-104444440.000000,
-104999992.000000,
-105000000.000000,
-105555552.000000,
-105714280.000000,
-106000000.000000,
-106250000.000000,
-107000000.000000,
-107142848.000000,
-107500000.000000,
-107777776.000000,
-108000000.000000,
-108333328.000000,
-108571424.000000,
-108750000.000000,
-108888888.000000,
-109000000.000000,
-109999992.000000,
-110000000.000000,
-111000000.000000,
-111111104.000000,
-111250000.000000,
-111428560.000000,
-111666664.000000,
-112000000.000000,
-112222216.000000,
-112500000.000000,
-112857136.000000,
-113333328.000000,
-113750000.000000,
-114000000.000000,
-114444440.000000,
-114999992.000000,
-115000000.000000,
-115555552.000000,
-115714280.000000,
-116000000.000000,
-116250000.000000,
-116666656.000000,
-116666664.000000,
-117142856.000000,
-117500000.000000,
-117777776.000000,
-118000000.000000,
-118333328.000000,
-118571424.000000,
-118750000.000000,
-118888888.000000,
-119999992.000000,
-120000000.000000,
-121111104.000000,
-121250000.000000,
-121428568.000000,
-121666656.000000,
-122000000.000000,
-122222216.000000,
-122500000.000000,
-122857136.000000,
-123333328.000000,
-123750000.000000,
-124000000.000000,
-124285712.000000,
-124999992.000000,
-125000000.000000,
-125714280.000000,
-126000000.000000,
-126250000.000000,
-126666656.000000,
-127142848.000000,
-127500000.000000,
-128333320.000000,
-128571424.000000,
-128750000.000000,
-129999984.000000,
-129999992.000000,
-130000000.000000,
-131250000.000000,
-131428560.000000,
-131666656.000000,
-132000000.000000,
-132500000.000000,
-132857136.000000,
-133750000.000000,
-134000000.000000,
-134285712.000000,
-135000000.000000,
-135714272.000000,
-136000000.000000,
-136250000.000000,
-136666672.000000,
-137500000.000000,
-138000000.000000,
-138333328.000000,
-138571440.000000,
-138750000.000000,
-140000000.000000,
-141428576.000000,
-141666672.000000,
-142000000.000000,
-142500000.000000,
-142857152.000000,
-143333328.000000,
-144000000.000000,
-144285712.000000,
-145000000.000000,
-145714288.000000,
-146000000.000000,
-146666656.000000,
-147142864.000000,
-147500000.000000,
-148000000.000000,
-148333328.000000,
-148571424.000000,
-150000000.000000,
-151428576.000000,
-151666656.000000,
-152000000.000000,
-152500000.000000,
-152857152.000000,
-153333328.000000,
-154000000.000000,
-154285712.000000,
-155000000.000000,
-155714288.000000,
-156000000.000000,
-156666656.000000,
-157142864.000000,
-157500000.000000,
-158000000.000000,
-158333328.000000,
-158571424.000000,
-161666672.000000,
-162000000.000000,
-162500000.000000,
-163333328.000000,
-164000000.000000,
-165000000.000000,
-166000000.000000,
-166666656.000000,
-166666672.000000,
-167500000.000000,
-168000000.000000,
-168333328.000000,
-170000000.000000,
-171666656.000000,
-172000000.000000,
-172500000.000000,
-173333328.000000,
-174000000.000000,
-175000000.000000,
-176000000.000000,
-176666656.000000,
-176666672.000000,
-177500000.000000,
-178000000.000000,
-178333328.000000,
-180000000.000000
-};
+// Highest sample rate advertised, faster rates can't be sustained over USB
+#define MAX_SAMPLE_RATE 180e6
+
+// The achievable rates are taken from the library's PLL model once
+static const std::vector<double> &getSampleRates(void)
+{
+    static const std::vector<double> rates = []() {
+        const double *list = NULL;
+        uint32_t n = fl2k_list_sample_rates(&list);
+        std::vector<double> results;
+
+        for (uint32_t i = 0; i < n && list[i] <= MAX_SAMPLE_RATE; i++)
+        {
+            results.push_back(list[i]);
+        }
+
+        return results;
+    }();
+
+    return rates;
+}
 
 std::vector<double> SoapyOsmoFL2K::listSampleRates(const int direction, const size_t channel) const
 {
-	int n = sizeof(SoapyOsmoFL2KSampleRates) / sizeof(SoapyOsmoFL2KSampleRates[0]);
-    std::vector<double> results(SoapyOsmoFL2KSampleRates, SoapyOsmoFL2KSampleRates + n);
+    return getSampleRates();
+}
+
+SoapySDR::RangeList SoapyOsmoFL2K::getSampleRateRange(const int direction, const size_t channel) const
+{
+    const std::vector<double> &rates = getSampleRates();
+    SoapySDR::RangeList results;
+
+    // any rate in between is accepted and set to the closest achievable one
+    if (!rates.empty())
+    {
+        results.push_back(SoapySDR::Range(rates.front(), rates.back()));
+    }
+
     return results;
 }
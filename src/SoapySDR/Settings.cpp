@@ -19,7 +19,8 @@ SoapyOsmoFL2K::SoapyOsmoFL2K(const SoapySDR::Kwargs &args)
     deviceId = -1;
     dev = NULL;
 
-    txFormat = FL2K_TX_FORMAT_FLOAT32;
+    txFormat = FL2K_FORMAT_F32;
+    bytesPerSample = sizeof(float);
 
     sampleRate = 2048000;
 
@@ -231,17 +232,17 @@ bool SoapyOsmoFL2K::hasFrequencyCorrection(const int direction, const size_t cha
 
 void SoapyOsmoFL2K::setSampleRate(const int direction, const size_t channel, const double rate)
 {
-    long long ns = SoapySDR::ticksToTimeNs(ticks, sampleRate);
+    long long ns = getHardwareTime();
     resetBuffer = true;
     fl2k_set_sample_rate(dev, rate);
-    sampleRate = fl2k_get_sample_rate(dev);
-    SoapySDR_logf(SOAPY_SDR_DEBUG, "Setting sample rate: %d", sampleRate);
-    ticks = SoapySDR::timeNsToTicks(ns, sampleRate);
+    sampleRate = fl2k_get_sample_rate_exact(dev);
+    SoapySDR_logf(SOAPY_SDR_DEBUG, "Setting sample rate: %f", sampleRate);
+    setHardwareTime(ns);
 }
 
 double SoapyOsmoFL2K::getSampleRate(const int direction, const size_t channel) const
 {
-    return fl2k_get_sample_rate(dev);
+    return fl2k_get_sample_rate_exact(dev);
 }
 
 
@@ -287,12 +288,17 @@ bool SoapyOsmoFL2K::hasHardwareTime(const std::string &what) const
 
 long long SoapyOsmoFL2K::getHardwareTime(const std::string &what) const
 {
-    return SoapySDR::ticksToTimeNs(ticks, sampleRate);
+    // samples sent by the library so far, on top of the time base
+    uint64_t count = 0;
+    fl2k_get_sample_count(dev, &count, NULL);
+    return SoapySDR::ticksToTimeNs(ticks + (long long) count, sampleRate);
 }
 
 void SoapyOsmoFL2K::setHardwareTime(const long long timeNs, const std::string &what)
 {
-    ticks = SoapySDR::timeNsToTicks(timeNs, sampleRate);
+    uint64_t count = 0;
+    fl2k_get_sample_count(dev, &count, NULL);
+    ticks = SoapySDR::timeNsToTicks(timeNs, sampleRate) - (long long) count;
 }
 
 
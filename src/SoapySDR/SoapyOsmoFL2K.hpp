@@ -4,20 +4,9 @@
 #include <thread>
 #include <osmo-fl2k.h>
 
-typedef enum fl2kTXFormat
-{
-    FL2K_TX_FORMAT_FLOAT32,
-    FL2K_TX_FORMAT_INT16,
-    FL2K_TX_FORMAT_INT8,
-    FL2K_TX_FORMAT_UINT16,
-    FL2K_TX_FORMAT_UINT8
-} fl2kTXFormat;
-
 #define DEFAULT_NUM_BUFFERS 4
-#define BYTES_PER_SAMPLE 1
 
-// TODO: Is this correct?
-#define DEFAULT_BUFFER_LENGTH FL2K_XFER_LEN
+#define DEFAULT_BUFFER_LENGTH FL2K_BUF_LEN
 
 /***********************************************************************
  * Device interface
@@ -139,6 +128,8 @@ public:
 
     std::vector<double> listSampleRates(const int direction, const size_t channel) const;
 
+    SoapySDR::RangeList getSampleRateRange(const int direction, const size_t channel) const;
+
     void setBandwidth(const int direction, const size_t channel, const double bw);
 
     double getBandwidth(const int direction, const size_t channel) const;
@@ -189,10 +180,11 @@ private:
     fl2k_dev_t *dev;
     
     //cached settings
-    fl2kTXFormat txFormat;
-    uint32_t sampleRate;
+    enum fl2k_sample_format txFormat; // narrowed to 8 bits by the library
+    size_t bytesPerSample;
+    double sampleRate;
     size_t bufferLength, asyncBuffs;
-    std::atomic<long long> ticks;
+    std::atomic<long long> ticks; // hardware time of the library's sample 0
     bool _signed;
     std::vector<size_t> _channels;
     
@@ -202,10 +194,11 @@ private:
 public:
     struct Buffer
     {
-        unsigned long long tick;
-        unsigned char red[FL2K_BUF_LEN];
-        unsigned char green[FL2K_BUF_LEN];
-        unsigned char blue[FL2K_BUF_LEN];
+        bool timed; // send at tick instead of right away
+        unsigned long long tick; // library sample to send at
+        std::vector<unsigned char> red;
+        std::vector<unsigned char> green;
+        std::vector<unsigned char> blue;
     };
 
     //async api usage
@@ -220,6 +213,7 @@ public:
     std::atomic<ssize_t>	_buf_count;
     unsigned char * _currentBuffs[3];
     std::atomic<bool> _underflowEvent;
+    std::atomic<bool> _lateEvent;
     size_t _currentHandle;
     size_t bufferedElems;
     long long bufTicks;
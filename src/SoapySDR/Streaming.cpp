@@ -74,8 +74,8 @@ SoapySDR::ArgInfoList SoapyOsmoFL2K::getStreamArgsInfo(const int direction, cons
     bufflenArg.key = "bufflen";
     bufflenArg.value = std::to_string(DEFAULT_BUFFER_LENGTH);
     bufflenArg.name = "Buffer Size";
-    bufflenArg.description = "Number of bytes per buffer, multiples of 512 only.";
-    bufflenArg.units = "bytes";
+    bufflenArg.description = "Number of samples per buffer, multiples of 20480 only.";
+    bufflenArg.units = "samples";
     bufflenArg.type = SoapySDR::ArgInfo::INT;
 
     streamArgs.push_back(bufflenArg);
@@ -114,6 +114,17 @@ static void _tx_callback(fl2k_data_info_t *data_info)
     self->tx_callback(data_info);
 }
 
+static void _tx_done_hook(void *ctx, uint64_t tick, uint64_t target_tick, int timed)
+{
+    SoapyOsmoFL2K *self = (SoapyOsmoFL2K *) ctx;
+
+    // Report timed buffers that could not be sent in time
+    if (timed and tick > target_tick)
+    {
+        self->_lateEvent = true;
+    }
+}
+
 const std::string &SoapyOsmoFL2K::fl2kErrorToString(enum fl2k_error error)
 {
     static const std::map<enum fl2k_error, std::string> errorToStringMap =
@@ -122,10 +133,12 @@ const std::string &SoapyOsmoFL2K::fl2kErrorToString(enum fl2k_error error)
         { FL2K_TRUE,                "FL2K_TRUE" },
         { FL2K_ERROR_INVALID_PARAM, "FL2K_ERROR_INVALID_PARAM" },
         { FL2K_ERROR_NO_DEVICE,     "FL2K_ERROR_NO_DEVICE" },
+        { FL2K_ERROR_ACCESS,        "FL2K_ERROR_ACCESS" },
         { FL2K_ERROR_NOT_FOUND,     "FL2K_ERROR_NOT_FOUND" },
         { FL2K_ERROR_BUSY,          "FL2K_ERROR_BUSY" },
         { FL2K_ERROR_TIMEOUT,       "FL2K_ERROR_TIMEOUT" },
         { FL2K_ERROR_NO_MEM,        "FL2K_ERROR_NO_MEM" },
+        { FL2K_ERROR_NOT_SUPPORTED, "FL2K_ERROR_NOT_SUPPORTED" },
     };
     
     // TODO: Is this thread safe?
@@ -155,9 +168,6 @@ void SoapyOsmoFL2K::tx_callback(fl2k_data_info_t *data_info)
         << data_info->underflow_cnt
         << "\n";
 
-    // atomically add len to ticks but return the previous value
-    unsigned long long tick = ticks.fetch_add(data_info->len);
-
     // Check the underflow count and exit early if there was an underflow
     if (data_info->underflow_cnt > 0)
     {
@@ -181,7 +191,8 @@ void SoapyOsmoFL2K::tx_callback(fl2k_data_info_t *data_info)
 
     // Give the driver the next filled buffer
     auto &buff = _buffs[_buf_tail];
-    buff.tick = tick;
+    data_info->tx_timed = buff.timed;
+    data_info->tx_tick = buff.tick;
     
     // Process each enabled channel
     for (const auto& channel: _channels)
@@ -189,13 +200,23 @@ void SoapyOsmoFL2K::tx_callback(fl2k_data_info_t *data_info)
         void *ptr;
         switch (channel)
         {
-            case 0: data_info->r_buf = (char *) buff.red; break;
-            case 1: data_info->g_buf = (char *) buff.green; break;
-            case 2: data_info->b_buf = (char *) buff.blue; break;
+            case 0:
+                data_info->r_buf = (char *) buff.red.data();
+                data_info->r_format = txFormat;
+                break;
+            case 1:
+                data_info->g_buf = (char *) buff.green.data();
+                data_info->g_format = txFormat;
+                break;
+            case 2:
+                data_info->b_buf = (char *) buff.blue.data();
+                data_info->b_format = txFormat;
+                break;
             default: break;
         }
     }
 
+    // The library narrows, saturates and interleaves the samples
     data_info->sampletype_signed = _signed;
     
     // Advance the tail to point to the next buffer
@@ -254,28 +275,33 @@ SoapySDR::Stream *SoapyOsmoFL2K::setupStream(
     if (format == SOAPY_SDR_F32)
     {
         SoapySDR_log(SOAPY_SDR_INFO, "Using format F32.");
-        txFormat = FL2K_TX_FORMAT_FLOAT32;
+        txFormat = FL2K_FORMAT_F32;
+        bytesPerSample = sizeof(float);
         _signed = true;
     }
     else if (format == SOAPY_SDR_S16)
     {
         SoapySDR_log(SOAPY_SDR_INFO, "Using format S16.");
-        txFormat = FL2K_TX_FORMAT_INT16;
+        txFormat = FL2K_FORMAT_S16;
+        bytesPerSample = sizeof(int16_t);
         _signed = true;
     }
     else if (format == SOAPY_SDR_S8) {
         SoapySDR_log(SOAPY_SDR_INFO, "Using format S8.");
-        txFormat = FL2K_TX_FORMAT_INT8;
+        txFormat = FL2K_FORMAT_8BIT;
+        bytesPerSample = sizeof(int8_t);
         _signed = true;
     }
     else if (format == SOAPY_SDR_U16)
     {
         SoapySDR_log(SOAPY_SDR_INFO, "Using format U16.");
-        txFormat = FL2K_TX_FORMAT_UINT16;
+        txFormat = FL2K_FORMAT_U16;
+        bytesPerSample = sizeof(uint16_t);
     }
     else if (format == SOAPY_SDR_U8) {
         SoapySDR_log(SOAPY_SDR_INFO, "Using format U8.");
-        txFormat = FL2K_TX_FORMAT_UINT8;
+        txFormat = FL2K_FORMAT_8BIT;
+        bytesPerSample = sizeof(uint8_t);
     }
     else
     {
@@ -284,7 +310,8 @@ SoapySDR::Stream *SoapyOsmoFL2K::setupStream(
                         + "' -- Only S8, S16, U8, U16 and F32 are supported by the SoapyOsmoFL2K module.");
     }
 
-    // TODO: FL2K doesn't support a variable buffer length. It's fixed. Do we need to support this argument?
+    // The transfer length has to be a multiple of the URB payload,
+    // round to the nearest supported length
     bufferLength = DEFAULT_BUFFER_LENGTH;
     if (args.count("bufflen") != 0)
     {
@@ -293,11 +320,17 @@ SoapySDR::Stream *SoapyOsmoFL2K::setupStream(
             int bufferLength_in = std::stoi(args.at("bufflen"));
             if (bufferLength_in > 0)
             {
-                bufferLength = bufferLength_in;
+                bufferLength = (bufferLength_in + FL2K_BUF_LEN_MIN / 2) / FL2K_BUF_LEN_MIN * FL2K_BUF_LEN_MIN;
+                bufferLength = std::min<size_t>(std::max<size_t>(bufferLength, FL2K_BUF_LEN_MIN), FL2K_BUF_LEN);
             }
         }
         catch (const std::invalid_argument &){}
     }
+    int ret = fl2k_set_buffer_len(dev, bufferLength);
+    if (ret < 0)
+    {
+        throw std::runtime_error("setupStream: failed to set buffer length: " + fl2kErrorToString(ret));
+    }
     SoapySDR_logf(SOAPY_SDR_DEBUG, "Osmo-FL2K Using buffer length %d", bufferLength);
 
     asyncBuffs = DEFAULT_NUM_BUFFERS;
@@ -335,6 +368,12 @@ SoapySDR::Stream *SoapyOsmoFL2K::setupStream(
 
     // Allocate buffers
     _buffs.resize(asyncBuffs);
+    for (auto &buff: _buffs)
+    {
+        buff.red.resize(bufferLength * bytesPerSample);
+        buff.green.resize(bufferLength * bytesPerSample);
+        buff.blue.resize(bufferLength * bytesPerSample);
+    }
 
     return (SoapySDR::Stream *) this;
 }
@@ -347,7 +386,7 @@ void SoapyOsmoFL2K::closeStream(SoapySDR::Stream *stream)
 
 size_t SoapyOsmoFL2K::getStreamMTU(SoapySDR::Stream *stream) const
 {
-    return bufferLength / BYTES_PER_SAMPLE;
+    return bufferLength;
 }
 
 int SoapyOsmoFL2K::activateStream(
@@ -359,7 +398,14 @@ int SoapyOsmoFL2K::activateStream(
     if (flags != 0) return SOAPY_SDR_NOT_SUPPORTED;
     resetBuffer = true;
     bufferedElems = 0;
-    
+    _lateEvent = false;
+
+    // The library counts samples from 0 again, keep the hardware time going
+    uint64_t count = 0;
+    fl2k_get_sample_count(dev, &count, NULL);
+    ticks += count;
+
+    fl2k_set_tx_done_hook(dev, &_tx_done_hook, this);
     return fl2k_start_tx(dev, &_tx_callback, this, asyncBuffs);
 }
 
@@ -390,47 +436,10 @@ int SoapyOsmoFL2K::writeStreamForChannel(
         unsigned char *currentBuff,
         size_t returnedElems)
 {
-     // Translate from signed float to unsigned uchar
-     if (txFormat == FL2K_TX_FORMAT_FLOAT32)
-     {
-         float *fsource = (float *) buff;
-         _signed = true;
-         for (size_t i = 0; i < returnedElems; i++)
-         {
-             float scaled = fsource[i] * 128.0;
-             int8_t truncated = (int8_t) scaled;
-             currentBuff[i] = truncated;
-             //_currentBuff[i] = (int8_t) (fsource[i] * 255.0);
-         }
-     }
-     else if (txFormat == FL2K_TX_FORMAT_INT16)
-     {
-         int16_t *isource = (int16_t *) buff;
-         _signed = true;
-         for (size_t i = 0; i < returnedElems; i++)
-         {
-             // TODO: Check this for correctness.
-             currentBuff[i] = isource[i] / 8;
-         }
-     }
-     else if (txFormat == FL2K_TX_FORMAT_INT8)
-     {
-         _signed = true;
-     }
-     else if (txFormat == FL2K_TX_FORMAT_UINT16)
-     {
-         int16_t *isource = (int16_t *) buff;
-         _signed = false;
-         for (size_t i = 0; i < returnedElems; i++)
-         {
-             // TODO: Check this for correctness.
-             currentBuff[i] = isource[i] / 8;
-         }
-     }
-     else if (txFormat == FL2K_TX_FORMAT_UINT8)
-     {
-         _signed = false;
-     }
+     // Samples are kept in their own format, the library converts
+     // them while interleaving the transfer buffer
+     std::memcpy(currentBuff, buff, returnedElems * bytesPerSample);
+     return returnedElems;
 }
 
 int SoapyOsmoFL2K::writeStream(
@@ -447,6 +456,17 @@ int SoapyOsmoFL2K::writeStream(
         bufferedElems = 0;
         this->releaseWriteBuffer(stream, _currentHandle, numElems, flags, timeNs);
     }
+
+    // A timed write starts a new buffer, pad the current one with zeroes
+    if ((flags & SOAPY_SDR_HAS_TIME) and bufferedElems != 0)
+    {
+        for (const auto& channel: _channels)
+        {
+            std::memset(_currentBuffs[channel], 0, bufferedElems*bytesPerSample);
+        }
+        bufferedElems = 0;
+        this->releaseWriteBuffer(stream, _currentHandle, numElems, flags, timeNs);
+    }
     
     //are elements left in the buffer? if not, do a new write.
     if (bufferedElems == 0)
@@ -454,6 +474,36 @@ int SoapyOsmoFL2K::writeStream(
         int ret = this->acquireWriteBuffer(stream, _currentHandle, (void **) _currentBuffs, timeoutUs);
         if (ret < 0) return ret;
         bufferedElems = ret;
+
+        // Let the library hold the buffer back until its time. Buffers
+        // only start on multiples of the buffer length, so pad the
+        // samples before the time with zeroes. A buffer whose time
+        // already passed is reported as late and sent right away.
+        if (flags & SOAPY_SDR_HAS_TIME)
+        {
+            long long tick = SoapySDR::timeNsToTicks(timeNs, sampleRate) - ticks;
+            uint64_t count = 0;
+            fl2k_get_sample_count(dev, &count, NULL);
+
+            if (tick < 0 or (unsigned long long) (tick - tick % bufferLength) < count)
+            {
+                _lateEvent = true;
+            }
+            else
+            {
+                size_t pad = tick % bufferLength;
+                _buffs[_currentHandle].timed = true;
+                _buffs[_currentHandle].tick = tick - pad;
+
+                for (const auto& channel: _channels)
+                {
+                    std::memset(_currentBuffs[channel], 0, pad*bytesPerSample);
+                    _currentBuffs[channel] += pad*bytesPerSample;
+                }
+                bufferedElems -= pad;
+                bufTicks += pad;
+            }
+        }
     }
 
     //otherwise just update return time to the current tick count
@@ -472,7 +522,7 @@ int SoapyOsmoFL2K::writeStream(
         this->writeStreamForChannel(buffs[channel], _currentBuffs[channel], returnedElems);
         
         //bump variables for next call into writeStream
-        _currentBuffs[channel] += returnedElems*BYTES_PER_SAMPLE;
+        _currentBuffs[channel] += returnedElems*bytesPerSample;
     }
                       
     //bump variables for next call into writeStream
@@ -508,6 +558,13 @@ int SoapyOsmoFL2K::readStreamStatus(
              SoapySDR::log(SOAPY_SDR_SSI, "U");
              return SOAPY_SDR_UNDERFLOW;
          }
+
+         if(_lateEvent)
+         {
+             _lateEvent = false;
+             SoapySDR::log(SOAPY_SDR_SSI, "L");
+             return SOAPY_SDR_TIME_ERROR;
+         }
         
 
         // sleep for a fraction of the total timeout
@@ -533,9 +590,9 @@ size_t SoapyOsmoFL2K::getNumDirectAccessBuffers(SoapySDR::Stream *stream)
 int SoapyOsmoFL2K::getDirectAccessBufferAddrs(SoapySDR::Stream *stream, const size_t handle, void **buffs)
 {
     // TODO: Is this effected by the enabled channels?
-    buffs[0] = (void *) _buffs[handle].red;
-    buffs[1] = (void *) _buffs[handle].green;
-    buffs[2] = (void *) _buffs[handle].blue;
+    buffs[0] = (void *) _buffs[handle].red.data();
+    buffs[1] = (void *) _buffs[handle].green.data();
+    buffs[2] = (void *) _buffs[handle].blue.data();
     return 0;
 }
 
@@ -585,7 +642,9 @@ int SoapyOsmoFL2K::acquireWriteBuffer(
     // Extract handle and buffer
     handle = _buf_head;
     _buf_head = (_buf_head + 1) % _buffs.size();
-    bufTicks = _buffs[handle].tick;
+    _buffs[handle].timed = false;
+    _buffs[handle].tick = 0;
+    bufTicks = 0;
     //timeNs = SoapySDR::ticksToTimeNs(_buffs[handle].tick, sampleRate);
     
     // Process each enabled channel
@@ -594,16 +653,16 @@ int SoapyOsmoFL2K::acquireWriteBuffer(
         void *ptr;
         switch (channel)
         {
-            case 0: ptr = (void *)_buffs[handle].red; break;
-            case 1: ptr = (void *)_buffs[handle].green; break;
-            case 2: ptr = (void *)_buffs[handle].blue; break;
+            case 0: ptr = (void *)_buffs[handle].red.data(); break;
+            case 1: ptr = (void *)_buffs[handle].green.data(); break;
+            case 2: ptr = (void *)_buffs[handle].blue.data(); break;
             default: break;
         }
         buffs[channel] = ptr;
     }
 
     // Return the number of elements available
-    return sizeof(_buffs[handle].red) / BYTES_PER_SAMPLE;
+    return _buffs[handle].red.size() / bytesPerSample;
 }
 
 
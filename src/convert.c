@@ -0,0 +1,1162 @@
+/*
+ * osmo-fl2k, turns FL2000-based USB 3.0 to VGA adapters into
+ * low cost DACs
+ *
+ * Copyright (C) 2016-2018 by Steve Markgraf <steve@steve-m.de>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+#include "osmo-fl2k.h"
+#include "convert.h"
+
+/* Position of the 8 samples of each DAC within a 24 byte block */
+static const uint8_t r_pos[FL2K_BLOCK_SAMPLES] = { 6,  1, 12, 15, 10, 21, 16, 19 };
+static const uint8_t g_pos[FL2K_BLOCK_SAMPLES] = { 5,  0,  3, 14,  9, 20, 23, 18 };
+static const uint8_t b_pos[FL2K_BLOCK_SAMPLES] = { 4,  7,  2, 13,  8, 11, 22, 17 };
+
+uint32_t fl2k_get_raw_offset(uint32_t channel, uint32_t sample)
+{
+	const uint8_t *pos[3] = { r_pos, g_pos, b_pos };
+
+	if (channel > 2)
+		channel = 2;
+
+	return (sample / FL2K_BLOCK_SAMPLES) * FL2K_BLOCK_LEN +
+	       pos[channel][sample % FL2K_BLOCK_SAMPLES];
+}
+
+/* Buffer format conversion functions for R, G, B DACs */
+static void fl2k_convert_r(char *out,
+			   const char *in,
+			   uint32_t len,
+			   uint8_t offset)
+{
+	unsigned int i, j = 0;
+
+	if (!in || !out)
+		return;
+
+	for (i = 0; i < len; i += 24) {
+		out[i+ 6] = in[j++] + offset;
+		out[i+ 1] = in[j++] + offset;
+		out[i+12] = in[j++] + offset;
+		out[i+15] = in[j++] + offset;
+		out[i+10] = in[j++] + offset;
+		out[i+21] = in[j++] + offset;
+		out[i+16] = in[j++] + offset;
+		out[i+19] = in[j++] + offset;
+	}
+}
+
+static void fl2k_convert_g(char *out,
+			   const char *in,
+			   uint32_t len,
+			   uint8_t offset)
+{
+	unsigned int i, j = 0;
+
+	if (!in || !out)
+		return;
+
+	for (i = 0; i < len; i += 24) {
+		out[i+ 5] = in[j++] + offset;
+		out[i+ 0] = in[j++] + offset;
+		out[i+ 3] = in[j++] + offset;
+		out[i+14] = in[j++] + offset;
+		out[i+ 9] = in[j++] + offset;
+		out[i+20] = in[j++] + offset;
+		out[i+23] = in[j++] + offset;
+		out[i+18] = in[j++] + offset;
+	}
+}
+
+static void fl2k_convert_b(char *out,
+			   const char *in,
+			   uint32_t len,
+			   uint8_t offset)
+{
+	unsigned int i, j = 0;
+
+	if (!in || !out)
+		return;
+
+	for (i = 0; i < len; i += 24) {
+		out[i+ 4] = in[j++] + offset;
+		out[i+ 7] = in[j++] + offset;
+		out[i+ 2] = in[j++] + offset;
+		out[i+13] = in[j++] + offset;
+		out[i+ 8] = in[j++] + offset;
+		out[i+11] = in[j++] + offset;
+		out[i+22] = in[j++] + offset;
+		out[i+17] = in[j++] + offset;
+	}
+}
+
+/* Stands in for the input buffer of unused DACs, so that they output
+ * the offset value without a branch in the inner loops */
+static const char zero_samples[32];
+
+static void fl2k_convert_rgb(char *out,
+			     const char *r,
+			     const char *g,
+			     const char *b,
+			     uint32_t len,
+			     uint8_t offset)
+{
+	unsigned int i;
+	unsigned int r_step = r ? 8 : 0;
+	unsigned int g_step = g ? 8 : 0;
+	unsigned int b_step = b ? 8 : 0;
+
+	if (!out)
+		return;
+
+	if (!r)
+		r = zero_samples;
+	if (!g)
+		g = zero_samples;
+	if (!b)
+		b = zero_samples;
+
+	for (i = 0; i < len; i += 24) {
+		out[i+ 0] = g[1] + offset;
+		out[i+ 1] = r[1] + offset;
+		out[i+ 2] = b[2] + offset;
+		out[i+ 3] = g[2] + offset;
+		out[i+ 4] = b[0] + offset;
+		out[i+ 5] = g[0] + offset;
+		out[i+ 6] = r[0] + offset;
+		out[i+ 7] = b[1] + offset;
+		out[i+ 8] = b[4] + offset;
+		out[i+ 9] = g[4] + offset;
+		out[i+10] = r[4] + offset;
+		out[i+11] = b[5] + offset;
+		out[i+12] = r[2] + offset;
+		out[i+13] = b[3] + offset;
+		out[i+14] = g[3] + offset;
+		out[i+15] = r[3] + offset;
+		out[i+16] = r[6] + offset;
+		out[i+17] = b[7] + offset;
+		out[i+18] = g[7] + offset;
+		out[i+19] = r[7] + offset;
+		out[i+20] = g[5] + offset;
+		out[i+21] = r[5] + offset;
+		out[i+22] = b[6] + offset;
+		out[i+23] = g[6] + offset;
+
+		r += r_step;
+		g += g_step;
+		b += b_step;
+	}
+}
+
+/* Inverse of fl2k_convert_rgb(), only complete blocks are split */
+static void fl2k_split_rgb(const char *in,
+			   char *r,
+			   char *g,
+			   char *b,
+			   uint32_t len,
+			   uint8_t offset)
+{
+	const uint8_t *pos[3] = { r_pos, g_pos, b_pos };
+	char *out[3] = { r, g, b };
+	unsigned int dac, i, j, k;
+
+	if (!in)
+		return;
+
+	for (dac = 0; dac < 3; dac++) {
+		if (!out[dac])
+			continue;
+
+		for (i = 0, j = 0; i + FL2K_BLOCK_LEN <= len; i += FL2K_BLOCK_LEN) {
+			for (k = 0; k < FL2K_BLOCK_SAMPLES; k++)
+				out[dac][j++] = in[i + pos[dac][k]] - offset;
+		}
+	}
+}
+
+/* The narrowing below rounds to nearest with halves going up, and all
+ * variants give the same result for every input, NaN included */
+static void fl2k_narrow_s8(char *out, const void *in, uint32_t len)
+{
+	const uint8_t *s = in;
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+		out[i] = s[i] ^ 0x80;
+}
+
+static void fl2k_narrow_s16(char *out, const void *in, uint32_t len)
+{
+	const int16_t *s = in;
+	int v;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		v = (s[i] + 128) >> 8;
+		out[i] = (v > 127 ? 127 : v) + 128;
+	}
+}
+
+static void fl2k_narrow_u16(char *out, const void *in, uint32_t len)
+{
+	const uint16_t *s = in;
+	int v;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		v = (s[i] + 128) >> 8;
+		out[i] = v > 255 ? 255 : v;
+	}
+}
+
+/* Full scale is +-128 like an 8 bit sample, so +1.0 saturates at 127 */
+static void fl2k_narrow_f32(char *out, const void *in, uint32_t len)
+{
+	const float *s = in;
+	float v;
+	uint32_t i;
+
+	for (i = 0; i < len; i++) {
+		v = s[i] * 128.0f;
+		if (!(v >= -128.0f))
+			v = -128.0f;
+		if (v > 127.0f)
+			v = 127.0f;
+		out[i] = (int)(v + 128.5f);
+	}
+}
+
+static void fl2k_lut(char *out, const char *in, uint32_t len,
+		     const uint8_t *lut)
+{
+	uint32_t i;
+
+	for (i = 0; i < len; i++)
+		out[i] = lut[(uint8_t)in[i]];
+}
+
+static const fl2k_convert_fn_t scalar_convert[3] = {
+	fl2k_convert_r, fl2k_convert_g, fl2k_convert_b
+};
+
+/*
+ * The SIMD variants work on 16 input samples of a DAC at once, which
+ * make up two blocks or three 16 byte vectors of output. For every DAC
+ * and vector there is a byte shuffle mask moving the samples to their
+ * place (0x80 yields a zero byte), and a mask keeping the bytes of the
+ * other two DACs that are already in the output buffer.
+ */
+static uint8_t shuf_mask[3][3][16];
+static uint8_t keep_mask[3][3][16];
+
+/* For splitting, the 16 samples of a DAC are gathered from the three
+ * vectors, each of them shuffled by a mask of its own */
+static uint8_t split_mask[3][3][16];
+
+static void init_masks(void)
+{
+	const uint8_t *pos[3] = { r_pos, g_pos, b_pos };
+	unsigned int dac, i, o;
+
+	memset(shuf_mask, 0x80, sizeof(shuf_mask));
+	memset(keep_mask, 0xff, sizeof(keep_mask));
+	memset(split_mask, 0x80, sizeof(split_mask));
+
+	for (dac = 0; dac < 3; dac++) {
+		for (i = 0; i < 2 * FL2K_BLOCK_SAMPLES; i++) {
+			o = (i / FL2K_BLOCK_SAMPLES) * FL2K_BLOCK_LEN +
+			    pos[dac][i % FL2K_BLOCK_SAMPLES];
+
+			shuf_mask[dac][o / 16][o % 16] = i;
+			keep_mask[dac][o / 16][o % 16] = 0;
+			split_mask[dac][o / 16][i] = o % 16;
+		}
+	}
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("ssse3")))
+static void convert_ssse3(char *out, const char *in, uint32_t len,
+			  uint8_t offset, int dac)
+{
+	const __m128i off = _mm_set1_epi8((char)offset);
+	const __m128i s0 = _mm_loadu_si128((const __m128i *)shuf_mask[dac][0]);
+	const __m128i s1 = _mm_loadu_si128((const __m128i *)shuf_mask[dac][1]);
+	const __m128i s2 = _mm_loadu_si128((const __m128i *)shuf_mask[dac][2]);
+	const __m128i k0 = _mm_loadu_si128((const __m128i *)keep_mask[dac][0]);
+	const __m128i k1 = _mm_loadu_si128((const __m128i *)keep_mask[dac][1]);
+	const __m128i k2 = _mm_loadu_si128((const __m128i *)keep_mask[dac][2]);
+	uint32_t i, j = 0;
+
+	if (!in || !out)
+		return;
+
+	for (i = 0; i + 48 <= len; i += 48, j += 16) {
+		__m128i v = _mm_add_epi8(_mm_loadu_si128((const __m128i *)(in + j)), off);
+		__m128i *o = (__m128i *)(out + i);
+
+		_mm_storeu_si128(o + 0, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(o + 0), k0),
+						     _mm_shuffle_epi8(v, s0)));
+		_mm_storeu_si128(o + 1, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(o + 1), k1),
+						     _mm_shuffle_epi8(v, s1)));
+		_mm_storeu_si128(o + 2, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(o + 2), k2),
+						     _mm_shuffle_epi8(v, s2)));
+	}
+
+	if (i < len)
+		scalar_convert[dac](out + i, in + j, len - i, offset);
+}
+
+/* vpshufb only shuffles within 128 bit lanes, so the 96 output bytes of
+ * 32 input samples are built from the lower, both and the upper half of
+ * the input, using the same masks as the SSSE3 variant */
+__attribute__((target("avx2")))
+static void convert_avx2(char *out, const char *in, uint32_t len,
+			 uint8_t offset, int dac)
+{
+	const __m256i off = _mm256_set1_epi8((char)offset);
+	const __m128i s0 = _mm_loadu_si128((const __m128i *)shuf_mask[dac][0]);
+	const __m128i s1 = _mm_loadu_si128((const __m128i *)shuf_mask[dac][1]);
+	const __m128i s2 = _mm_loadu_si128((const __m128i *)shuf_mask[dac][2]);
+	const __m128i k0 = _mm_loadu_si128((const __m128i *)keep_mask[dac][0]);
+	const __m128i k1 = _mm_loadu_si128((const __m128i *)keep_mask[dac][1]);
+	const __m128i k2 = _mm_loadu_si128((const __m128i *)keep_mask[dac][2]);
+	const __m256i s01 = _mm256_inserti128_si256(_mm256_castsi128_si256(s0), s1, 1);
+	const __m256i s20 = _mm256_inserti128_si256(_mm256_castsi128_si256(s2), s0, 1);
+	const __m256i s12 = _mm256_inserti128_si256(_mm256_castsi128_si256(s1), s2, 1);
+	const __m256i k01 = _mm256_inserti128_si256(_mm256_castsi128_si256(k0), k1, 1);
+	const __m256i k20 = _mm256_inserti128_si256(_mm256_castsi128_si256(k2), k0, 1);
+	const __m256i k12 = _mm256_inserti128_si256(_mm256_castsi128_si256(k1), k2, 1);
+	uint32_t i, j = 0;
+
+	if (!in || !out)
+		return;
+
+	for (i = 0; i + 96 <= len; i += 96, j += 32) {
+		__m256i v = _mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(in + j)), off);
+		__m256i lo = _mm256_permute2x128_si256(v, v, 0x00);
+		__m256i hi = _mm256_permute2x128_si256(v, v, 0x11);
+		__m256i *o = (__m256i *)(out + i);
+
+		_mm256_storeu_si256(o + 0, _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256(o + 0), k01),
+							   _mm256_shuffle_epi8(lo, s01)));
+		_mm256_storeu_si256(o + 1, _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256(o + 1), k20),
+							   _mm256_shuffle_epi8(v, s20)));
+		_mm256_storeu_si256(o + 2, _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256(o + 2), k12),
+							   _mm256_shuffle_epi8(hi, s12)));
+	}
+
+	if (i < len)
+		convert_ssse3(out + i, in + j, len - i, offset, dac);
+}
+
+/* Fused variant: every output vector is written exactly once. The
+ * transfer buffer is not read again by the CPU, so if it is suitably
+ * aligned non-temporal stores keep it from evicting the input data */
+__attribute__((target("ssse3")))
+static void convert_rgb_ssse3(char *out, const char *r, const char *g,
+			      const char *b, uint32_t len, uint8_t offset)
+{
+	const __m128i off = _mm_set1_epi8((char)offset);
+	__m128i sr[3], sg[3], sb[3];
+	uint32_t i, k, r_step, g_step, b_step;
+	int stream = !((uintptr_t)out & 15);
+
+	if (!out)
+		return;
+
+	r_step = r ? 16 : 0;
+	g_step = g ? 16 : 0;
+	b_step = b ? 16 : 0;
+	r = r ? r : zero_samples;
+	g = g ? g : zero_samples;
+	b = b ? b : zero_samples;
+
+	for (k = 0; k < 3; k++) {
+		sr[k] = _mm_loadu_si128((const __m128i *)shuf_mask[0][k]);
+		sg[k] = _mm_loadu_si128((const __m128i *)shuf_mask[1][k]);
+		sb[k] = _mm_loadu_si128((const __m128i *)shuf_mask[2][k]);
+	}
+
+	for (i = 0; i + 48 <= len; i += 48) {
+		__m128i vr = _mm_add_epi8(_mm_loadu_si128((const __m128i *)r), off);
+		__m128i vg = _mm_add_epi8(_mm_loadu_si128((const __m128i *)g), off);
+		__m128i vb = _mm_add_epi8(_mm_loadu_si128((const __m128i *)b), off);
+		__m128i *o = (__m128i *)(out + i);
+
+		for (k = 0; k < 3; k++) {
+			__m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(vr, sr[k]),
+							      _mm_shuffle_epi8(vg, sg[k])),
+						 _mm_shuffle_epi8(vb, sb[k]));
+			if (stream)
+				_mm_stream_si128(o + k, v);
+			else
+				_mm_storeu_si128(o + k, v);
+		}
+
+		r += r_step;
+		g += g_step;
+		b += b_step;
+	}
+
+	if (stream)
+		_mm_sfence();
+
+	if (i < len)
+		fl2k_convert_rgb(out + i, r_step ? r : NULL, g_step ? g : NULL,
+				 b_step ? b : NULL, len - i, offset);
+}
+
+__attribute__((target("avx2")))
+static void convert_rgb_avx2(char *out, const char *r, const char *g,
+			     const char *b, uint32_t len, uint8_t offset)
+{
+	const __m256i off = _mm256_set1_epi8((char)offset);
+	__m256i s01[3], s20[3], s12[3];
+	uint32_t i, k, r_step, g_step, b_step;
+	int stream = !((uintptr_t)out & 31);
+
+	if (!out)
+		return;
+
+	r_step = r ? 32 : 0;
+	g_step = g ? 32 : 0;
+	b_step = b ? 32 : 0;
+	r = r ? r : zero_samples;
+	g = g ? g : zero_samples;
+	b = b ? b : zero_samples;
+
+	for (k = 0; k < 3; k++) {
+		__m128i s0 = _mm_loadu_si128((const __m128i *)shuf_mask[k][0]);
+		__m128i s1 = _mm_loadu_si128((const __m128i *)shuf_mask[k][1]);
+		__m128i s2 = _mm_loadu_si128((const __m128i *)shuf_mask[k][2]);
+
+		s01[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(s0), s1, 1);
+		s20[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(s2), s0, 1);
+		s12[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(s1), s2, 1);
+	}
+
+	for (i = 0; i + 96 <= len; i += 96) {
+		__m256i v[3], lo[3], hi[3], o0, o1, o2;
+		__m256i *o = (__m256i *)(out + i);
+
+		v[0] = _mm256_add_epi8(_mm256_loadu_si256((const __m256i *)r), off);
+		v[1] = _mm256_add_epi8(_mm256_loadu_si256((const __m256i *)g), off);
+		v[2] = _mm256_add_epi8(_mm256_loadu_si256((const __m256i *)b), off);
+
+		for (k = 0; k < 3; k++) {
+			lo[k] = _mm256_permute2x128_si256(v[k], v[k], 0x00);
+			hi[k] = _mm256_permute2x128_si256(v[k], v[k], 0x11);
+		}
+
+		o0 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(lo[0], s01[0]),
+						     _mm256_shuffle_epi8(lo[1], s01[1])),
+				     _mm256_shuffle_epi8(lo[2], s01[2]));
+		o1 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(v[0], s20[0]),
+						     _mm256_shuffle_epi8(v[1], s20[1])),
+				     _mm256_shuffle_epi8(v[2], s20[2]));
+		o2 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(hi[0], s12[0]),
+						     _mm256_shuffle_epi8(hi[1], s12[1])),
+				     _mm256_shuffle_epi8(hi[2], s12[2]));
+
+		if (stream) {
+			_mm256_stream_si256(o + 0, o0);
+			_mm256_stream_si256(o + 1, o1);
+			_mm256_stream_si256(o + 2, o2);
+		} else {
+			_mm256_storeu_si256(o + 0, o0);
+			_mm256_storeu_si256(o + 1, o1);
+			_mm256_storeu_si256(o + 2, o2);
+		}
+
+		r += r_step;
+		g += g_step;
+		b += b_step;
+	}
+
+	if (stream)
+		_mm_sfence();
+
+	if (i < len)
+		convert_rgb_ssse3(out + i, r_step ? r : NULL, g_step ? g : NULL,
+				  b_step ? b : NULL, len - i, offset);
+}
+
+__attribute__((target("ssse3")))
+static void split_rgb_ssse3(const char *in, char *r, char *g, char *b,
+			    uint32_t len, uint8_t offset)
+{
+	const __m128i off = _mm_set1_epi8((char)offset);
+	char *out[3] = { r, g, b };
+	__m128i s[3][3];
+	uint32_t i, j = 0, dac, k;
+
+	if (!in)
+		return;
+
+	for (dac = 0; dac < 3; dac++) {
+		for (k = 0; k < 3; k++)
+			s[dac][k] = _mm_loadu_si128((const __m128i *)split_mask[dac][k]);
+	}
+
+	for (i = 0; i + 48 <= len; i += 48, j += 16) {
+		__m128i v0 = _mm_loadu_si128((const __m128i *)(in + i));
+		__m128i v1 = _mm_loadu_si128((const __m128i *)(in + i + 16));
+		__m128i v2 = _mm_loadu_si128((const __m128i *)(in + i + 32));
+
+		for (dac = 0; dac < 3; dac++) {
+			__m128i v;
+
+			if (!out[dac])
+				continue;
+
+			v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, s[dac][0]),
+						      _mm_shuffle_epi8(v1, s[dac][1])),
+					 _mm_shuffle_epi8(v2, s[dac][2]));
+			_mm_storeu_si128((__m128i *)(out[dac] + j), _mm_sub_epi8(v, off));
+		}
+	}
+
+	if (i < len)
+		fl2k_split_rgb(in + i, r ? r + j : NULL, g ? g + j : NULL,
+			       b ? b + j : NULL, len - i, offset);
+}
+
+/* The lanes are rearranged so that the lower one holds the first and
+ * the upper one the second 48 bytes, like in the SSSE3 variant */
+__attribute__((target("avx2")))
+static void split_rgb_avx2(const char *in, char *r, char *g, char *b,
+			   uint32_t len, uint8_t offset)
+{
+	const __m256i off = _mm256_set1_epi8((char)offset);
+	char *out[3] = { r, g, b };
+	__m256i s[3][3];
+	uint32_t i, j = 0, dac, k;
+
+	if (!in)
+		return;
+
+	for (dac = 0; dac < 3; dac++) {
+		for (k = 0; k < 3; k++)
+			s[dac][k] = _mm256_broadcastsi128_si256(
+				_mm_loadu_si128((const __m128i *)split_mask[dac][k]));
+	}
+
+	for (i = 0; i + 96 <= len; i += 96, j += 32) {
+		__m256i o0 = _mm256_loadu_si256((const __m256i *)(in + i));
+		__m256i o1 = _mm256_loadu_si256((const __m256i *)(in + i + 32));
+		__m256i o2 = _mm256_loadu_si256((const __m256i *)(in + i + 64));
+		__m256i v0 = _mm256_blend_epi32(o0, o1, 0xf0);
+		__m256i v1 = _mm256_permute2x128_si256(o0, o2, 0x21);
+		__m256i v2 = _mm256_blend_epi32(o1, o2, 0xf0);
+
+		for (dac = 0; dac < 3; dac++) {
+			__m256i v;
+
+			if (!out[dac])
+				continue;
+
+			v = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(v0, s[dac][0]),
+							    _mm256_shuffle_epi8(v1, s[dac][1])),
+					    _mm256_shuffle_epi8(v2, s[dac][2]));
+			_mm256_storeu_si256((__m256i *)(out[dac] + j), _mm256_sub_epi8(v, off));
+		}
+	}
+
+	if (i < len)
+		split_rgb_ssse3(in + i, r ? r + j : NULL, g ? g + j : NULL,
+				b ? b + j : NULL, len - i, offset);
+}
+
+/* The narrowing is limited by the loads, so the AVX2 implementation
+ * uses these as well. Saturation comes from the saturating adds and
+ * packs, and for floats from clamping before the truncating conversion,
+ * where maxps returns the lower bound for NaN. */
+__attribute__((target("ssse3")))
+static void narrow_s8_sse(char *out, const void *in, uint32_t len)
+{
+	const __m128i sign = _mm_set1_epi8((char)0x80);
+	const char *s = in;
+	uint32_t i;
+
+	for (i = 0; i + 16 <= len; i += 16)
+		_mm_storeu_si128((__m128i *)(out + i),
+				 _mm_xor_si128(_mm_loadu_si128((const __m128i *)(s + i)), sign));
+
+	if (i < len)
+		fl2k_narrow_s8(out + i, s + i, len - i);
+}
+
+__attribute__((target("ssse3")))
+static void narrow_s16_sse(char *out, const void *in, uint32_t len)
+{
+	const __m128i round = _mm_set1_epi16(128);
+	const __m128i sign = _mm_set1_epi8((char)0x80);
+	const int16_t *s = in;
+	uint32_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(s + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(s + i + 8));
+
+		a = _mm_srai_epi16(_mm_adds_epi16(a, round), 8);
+		b = _mm_srai_epi16(_mm_adds_epi16(b, round), 8);
+		_mm_storeu_si128((__m128i *)(out + i),
+				 _mm_xor_si128(_mm_packs_epi16(a, b), sign));
+	}
+
+	if (i < len)
+		fl2k_narrow_s16(out + i, s + i, len - i);
+}
+
+__attribute__((target("ssse3")))
+static void narrow_u16_sse(char *out, const void *in, uint32_t len)
+{
+	const __m128i round = _mm_set1_epi16(128);
+	const uint16_t *s = in;
+	uint32_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(s + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(s + i + 8));
+
+		a = _mm_srli_epi16(_mm_adds_epu16(a, round), 8);
+		b = _mm_srli_epi16(_mm_adds_epu16(b, round), 8);
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(a, b));
+	}
+
+	if (i < len)
+		fl2k_narrow_u16(out + i, s + i, len - i);
+}
+
+__attribute__((target("ssse3")))
+static void narrow_f32_sse(char *out, const void *in, uint32_t len)
+{
+	const __m128 scale = _mm_set1_ps(128.0f);
+	const __m128 lo = _mm_set1_ps(-128.0f);
+	const __m128 hi = _mm_set1_ps(127.0f);
+	const __m128 bias = _mm_set1_ps(128.5f);
+	const float *s = in;
+	__m128i v[4];
+	uint32_t i, k;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		for (k = 0; k < 4; k++) {
+			__m128 f = _mm_mul_ps(_mm_loadu_ps(s + i + 4 * k), scale);
+
+			f = _mm_min_ps(_mm_max_ps(f, lo), hi);
+			v[k] = _mm_cvttps_epi32(_mm_add_ps(f, bias));
+		}
+
+		_mm_storeu_si128((__m128i *)(out + i),
+				 _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]),
+						  _mm_packs_epi32(v[2], v[3])));
+	}
+
+	if (i < len)
+		fl2k_narrow_f32(out + i, s + i, len - i);
+}
+
+/*
+ * A 256 entry table is looked up as 16 slices of 16 bytes, pshufb
+ * indexing each slice with the low nibble. Subtracting 0x10 per slice
+ * makes the high nibble zero for the slice of the sample, the
+ * saturating add of 0x70 then sets bit 7 for all other samples, which
+ * makes pshufb yield zero for them.
+ */
+__attribute__((target("ssse3")))
+static void lut_ssse3(char *out, const char *in, uint32_t len,
+		      const uint8_t *lut)
+{
+	const __m128i step = _mm_set1_epi8(0x10);
+	const __m128i sel = _mm_set1_epi8(0x70);
+	__m128i t[16];
+	uint32_t i, h;
+
+	for (h = 0; h < 16; h++)
+		t[h] = _mm_loadu_si128((const __m128i *)(lut + 16 * h));
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+		__m128i r = _mm_setzero_si128();
+
+		for (h = 0; h < 16; h++) {
+			r = _mm_or_si128(r, _mm_shuffle_epi8(t[h], _mm_adds_epu8(v, sel)));
+			v = _mm_sub_epi8(v, step);
+		}
+
+		_mm_storeu_si128((__m128i *)(out + i), r);
+	}
+
+	if (i < len)
+		fl2k_lut(out + i, in + i, len - i, lut);
+}
+
+__attribute__((target("avx2")))
+static void lut_avx2(char *out, const char *in, uint32_t len,
+		     const uint8_t *lut)
+{
+	const __m256i step = _mm256_set1_epi8(0x10);
+	const __m256i sel = _mm256_set1_epi8(0x70);
+	__m256i t[16];
+	uint32_t i, h;
+
+	for (h = 0; h < 16; h++)
+		t[h] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(lut + 16 * h)));
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+		__m256i r = _mm256_setzero_si256();
+
+		for (h = 0; h < 16; h++) {
+			r = _mm256_or_si256(r, _mm256_shuffle_epi8(t[h], _mm256_adds_epu8(v, sel)));
+			v = _mm256_sub_epi8(v, step);
+		}
+
+		_mm256_storeu_si256((__m256i *)(out + i), r);
+	}
+
+	if (i < len)
+		lut_ssse3(out + i, in + i, len - i, lut);
+}
+
+static void convert_r_ssse3(char *out, const char *in, uint32_t len, uint8_t offset)
+{
+	convert_ssse3(out, in, len, offset, 0);
+}
+
+static void convert_g_ssse3(char *out, const char *in, uint32_t len, uint8_t offset)
+{
+	convert_ssse3(out, in, len, offset, 1);
+}
+
+static void convert_b_ssse3(char *out, const char *in, uint32_t len, uint8_t offset)
+{
+	convert_ssse3(out, in, len, offset, 2);
+}
+
+static void convert_r_avx2(char *out, const char *in, uint32_t len, uint8_t offset)
+{
+	convert_avx2(out, in, len, offset, 0);
+}
+
+static void convert_g_avx2(char *out, const char *in, uint32_t len, uint8_t offset)
+{
+	convert_avx2(out, in, len, offset, 1);
+}
+
+static void convert_b_avx2(char *out, const char *in, uint32_t len, uint8_t offset)
+{
+	convert_avx2(out, in, len, offset, 2);
+}
+
+static const fl2k_convert_ops_t ssse3_ops = {
+	"ssse3", convert_r_ssse3, convert_g_ssse3, convert_b_ssse3,
+	convert_rgb_ssse3, split_rgb_ssse3,
+	narrow_s8_sse, narrow_s16_sse, narrow_u16_sse, narrow_f32_sse,
+	lut_ssse3
+};
+
+static const fl2k_convert_ops_t avx2_ops = {
+	"avx2", convert_r_avx2, convert_g_avx2, convert_b_avx2,
+	convert_rgb_avx2, split_rgb_avx2,
+	narrow_s8_sse, narrow_s16_sse, narrow_u16_sse, narrow_f32_sse,
+	lut_avx2
+};
+#endif /* HAVE_X86_SIMD */
+
+#ifdef HAVE_NEON
+static void convert_neon(char *out, const char *in, uint32_t len,
+			 uint8_t offset, int dac)
+{
+	const uint8x16_t off = vdupq_n_u8(offset);
+	const uint8x16_t s0 = vld1q_u8(shuf_mask[dac][0]);
+	const uint8x16_t s1 = vld1q_u8(shuf_mask[dac][1]);
+	const uint8x16_t s2 = vld1q_u8(shuf_mask[dac][2]);
+	const uint8x16_t k0 = vld1q_u8(keep_mask[dac][0]);
+	const uint8x16_t k1 = vld1q_u8(keep_mask[dac][1]);
+	const uint8x16_t k2 = vld1q_u8(keep_mask[dac][2]);
+	uint32_t i, j = 0;
+
+	if (!in || !out)
+		return;
+
+	/* tbl yields zero for out of range indices such as 0x80 */
+	for (i = 0; i + 48 <= len; i += 48, j += 16) {
+		uint8x16_t v = vaddq_u8(vld1q_u8((const uint8_t *)in + j), off);
+		uint8_t *o = (uint8_t *)out + i;
+
+		vst1q_u8(o +  0, vorrq_u8(vandq_u8(vld1q_u8(o +  0), k0), vqtbl1q_u8(v, s0)));
+		vst1q_u8(o + 16, vorrq_u8(vandq_u8(vld1q_u8(o + 16), k1), vqtbl1q_u8(v, s1)));
+		vst1q_u8(o + 32, vorrq_u8(vandq_u8(vld1q_u8(o + 32), k2), vqtbl1q_u8(v, s2)));
+	}
+
+	if (i < len)
+		scalar_convert[dac](out + i, in + j, len - i, offset);
+}
+
+static void convert_rgb_neon(char *out, const char *r, const char *g,
+			     const char *b, uint32_t len, uint8_t offset)
+{
+	const uint8x16_t off = vdupq_n_u8(offset);
+	uint8x16_t sr[3], sg[3], sb[3];
+	uint32_t i, k, r_step, g_step, b_step;
+
+	if (!out)
+		return;
+
+	r_step = r ? 16 : 0;
+	g_step = g ? 16 : 0;
+	b_step = b ? 16 : 0;
+	r = r ? r : zero_samples;
+	g = g ? g : zero_samples;
+	b = b ? b : zero_samples;
+
+	for (k = 0; k < 3; k++) {
+		sr[k] = vld1q_u8(shuf_mask[0][k]);
+		sg[k] = vld1q_u8(shuf_mask[1][k]);
+		sb[k] = vld1q_u8(shuf_mask[2][k]);
+	}
+
+	for (i = 0; i + 48 <= len; i += 48) {
+		uint8x16_t vr = vaddq_u8(vld1q_u8((const uint8_t *)r), off);
+		uint8x16_t vg = vaddq_u8(vld1q_u8((const uint8_t *)g), off);
+		uint8x16_t vb = vaddq_u8(vld1q_u8((const uint8_t *)b), off);
+		uint8_t *o = (uint8_t *)out + i;
+
+		for (k = 0; k < 3; k++)
+			vst1q_u8(o + 16 * k, vorrq_u8(vorrq_u8(vqtbl1q_u8(vr, sr[k]),
+							       vqtbl1q_u8(vg, sg[k])),
+						      vqtbl1q_u8(vb, sb[k])));
+
+		r += r_step;
+		g += g_step;
+		b += b_step;
+	}
+
+	if (i < len)
+		fl2k_convert_rgb(out + i, r_step ? r : NULL, g_step ? g : NULL,
+				 b_step ? b : NULL, len - i, offset);
+}
+
+static void split_rgb_neon(const char *in, char *r, char *g, char *b,
+			   uint32_t len, uint8_t offset)
+{
+	const uint8x16_t off = vdupq_n_u8(offset);
+	char *out[3] = { r, g, b };
+	uint8x16_t s[3][3];
+	uint32_t i, j = 0, dac, k;
+
+	if (!in)
+		return;
+
+	for (dac = 0; dac < 3; dac++) {
+		for (k = 0; k < 3; k++)
+			s[dac][k] = vld1q_u8(split_mask[dac][k]);
+	}
+
+	for (i = 0; i + 48 <= len; i += 48, j += 16) {
+		uint8x16_t v0 = vld1q_u8((const uint8_t *)in + i);
+		uint8x16_t v1 = vld1q_u8((const uint8_t *)in + i + 16);
+		uint8x16_t v2 = vld1q_u8((const uint8_t *)in + i + 32);
+
+		for (dac = 0; dac < 3; dac++) {
+			uint8x16_t v;
+
+			if (!out[dac])
+				continue;
+
+			v = vorrq_u8(vorrq_u8(vqtbl1q_u8(v0, s[dac][0]),
+					      vqtbl1q_u8(v1, s[dac][1])),
+				     vqtbl1q_u8(v2, s[dac][2]));
+			vst1q_u8((uint8_t *)out[dac] + j, vsubq_u8(v, off));
+		}
+	}
+
+	if (i < len)
+		fl2k_split_rgb(in + i, r ? r + j : NULL, g ? g + j : NULL,
+			       b ? b + j : NULL, len - i, offset);
+}
+
+/* vqrshrn rounds and saturates in one go, the NaN handling of vmaxnm
+ * and vminnm matches the scalar variant */
+static void narrow_s8_neon(char *out, const void *in, uint32_t len)
+{
+	const uint8x16_t sign = vdupq_n_u8(0x80);
+	const uint8_t *s = in;
+	uint32_t i;
+
+	for (i = 0; i + 16 <= len; i += 16)
+		vst1q_u8((uint8_t *)out + i, veorq_u8(vld1q_u8(s + i), sign));
+
+	if (i < len)
+		fl2k_narrow_s8(out + i, s + i, len - i);
+}
+
+static void narrow_s16_neon(char *out, const void *in, uint32_t len)
+{
+	const uint8x16_t sign = vdupq_n_u8(0x80);
+	const int16_t *s = in;
+	uint32_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		int8x16_t v = vcombine_s8(vqrshrn_n_s16(vld1q_s16(s + i), 8),
+					  vqrshrn_n_s16(vld1q_s16(s + i + 8), 8));
+
+		vst1q_u8((uint8_t *)out + i, veorq_u8(vreinterpretq_u8_s8(v), sign));
+	}
+
+	if (i < len)
+		fl2k_narrow_s16(out + i, s + i, len - i);
+}
+
+static void narrow_u16_neon(char *out, const void *in, uint32_t len)
+{
+	const uint16_t *s = in;
+	uint32_t i;
+
+	for (i = 0; i + 16 <= len; i += 16)
+		vst1q_u8((uint8_t *)out + i,
+			 vcombine_u8(vqrshrn_n_u16(vld1q_u16(s + i), 8),
+				     vqrshrn_n_u16(vld1q_u16(s + i + 8), 8)));
+
+	if (i < len)
+		fl2k_narrow_u16(out + i, s + i, len - i);
+}
+
+static void narrow_f32_neon(char *out, const void *in, uint32_t len)
+{
+	const float32x4_t lo = vdupq_n_f32(-128.0f);
+	const float32x4_t hi = vdupq_n_f32(127.0f);
+	const float32x4_t bias = vdupq_n_f32(128.5f);
+	const float *s = in;
+	uint16x4_t v[4];
+	uint32_t i, k;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		for (k = 0; k < 4; k++) {
+			float32x4_t f = vmulq_n_f32(vld1q_f32(s + i + 4 * k), 128.0f);
+
+			f = vminnmq_f32(vmaxnmq_f32(f, lo), hi);
+			v[k] = vmovn_u32(vcvtq_u32_f32(vaddq_f32(f, bias)));
+		}
+
+		vst1q_u8((uint8_t *)out + i,
+			 vcombine_u8(vmovn_u16(vcombine_u16(v[0], v[1])),
+				     vmovn_u16(vcombine_u16(v[2], v[3]))));
+	}
+
+	if (i < len)
+		fl2k_narrow_f32(out + i, s + i, len - i);
+}
+
+/* tbl yields zero and tbx keeps the result for indices past the 64 byte
+ * table, so four lookups cover all 256 entries */
+static void lut_neon(char *out, const char *in, uint32_t len,
+		     const uint8_t *lut)
+{
+	const uint8x16_t step = vdupq_n_u8(64);
+	uint8x16x4_t t[4];
+	uint32_t i, k;
+
+	for (k = 0; k < 4; k++) {
+		t[k].val[0] = vld1q_u8(lut + 64 * k);
+		t[k].val[1] = vld1q_u8(lut + 64 * k + 16);
+		t[k].val[2] = vld1q_u8(lut + 64 * k + 32);
+		t[k].val[3] = vld1q_u8(lut + 64 * k + 48);
+	}
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		uint8x16_t v = vld1q_u8((const uint8_t *)in + i);
+		uint8x16_t r = vqtbl4q_u8(t[0], v);
+
+		for (k = 1; k < 4; k++) {
+			v = vsubq_u8(v, step);
+			r = vqtbx4q_u8(r, t[k], v);
+		}
+
+		vst1q_u8((uint8_t *)out + i, r);
+	}
+
+	if (i < len)
+		fl2k_lut(out + i, in + i, len - i, lut);
+}
+
+static void convert_r_neon(char *out, const char *in, uint32_t len, uint8_t offset)
+{
+	convert_neon(out, in, len, offset, 0);
+}
+
+static void convert_g_neon(char *out, const char *in, uint32_t len, uint8_t offset)
+{
+	convert_neon(out, in, len, offset, 1);
+}
+
+static void convert_b_neon(char *out, const char *in, uint32_t len, uint8_t offset)
+{
+	convert_neon(out, in, len, offset, 2);
+}
+
+static const fl2k_convert_ops_t neon_ops = {
+	"neon", convert_r_neon, convert_g_neon, convert_b_neon,
+	convert_rgb_neon, split_rgb_neon,
+	narrow_s8_neon, narrow_s16_neon, narrow_u16_neon, narrow_f32_neon,
+	lut_neon
+};
+#endif /* HAVE_NEON */
+
+static const fl2k_convert_ops_t scalar_ops = {
+	"scalar", fl2k_convert_r, fl2k_convert_g, fl2k_convert_b,
+	fl2k_convert_rgb, fl2k_split_rgb,
+	fl2k_narrow_s8, fl2k_narrow_s16, fl2k_narrow_u16, fl2k_narrow_f32,
+	fl2k_lut
+};
+
+/* usable implementations, sorted from slowest to fastest */
+static const fl2k_convert_ops_t *impls[4];
+static unsigned int num_impls;
+static pthread_once_t impls_once = PTHREAD_ONCE_INIT;
+
+static void init_impls(void)
+{
+	init_masks();
+
+	impls[num_impls++] = &scalar_ops;
+
+#ifdef HAVE_X86_SIMD
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("ssse3"))
+		impls[num_impls++] = &ssse3_ops;
+
+	if (__builtin_cpu_supports("avx2"))
+		impls[num_impls++] = &avx2_ops;
+#endif
+
+#ifdef HAVE_NEON
+	/* NEON is mandatory on AArch64 */
+	impls[num_impls++] = &neon_ops;
+#endif
+}
+
+const fl2k_convert_ops_t *fl2k_convert_select(void)
+{
+	pthread_once(&impls_once, init_impls);
+
+	return impls[num_impls - 1];
+}
+
+const fl2k_convert_ops_t *fl2k_convert_get(unsigned int idx)
+{
+	pthread_once(&impls_once, init_impls);
+
+	if (idx >= num_impls)
+		return NULL;
+
+	return impls[idx];
+}
+
+/* Samples per DAC narrowed at once, small enough for the three chunks
+ * to stay in the L1 cache until they are interleaved */
+#define NARROW_CHUNK	2048
+
+void fl2k_convert_formats(const fl2k_convert_ops_t *ops, char *out,
+			  const void *const in[3], const int fmt[3],
+			  const uint8_t *const lut[3],
+			  int sampletype_signed, uint32_t len)
+{
+	char tmp[3][NARROW_CHUNK];
+	const char *src[3];
+	uint32_t i, n, dac;
+	uint32_t samples = len / FL2K_BLOCK_LEN * FL2K_BLOCK_SAMPLES;
+	uint8_t zero = sampletype_signed ? 128 : 0;
+
+	/* unused DACs stay at the zero level of the 8 bit sample type */
+	for (dac = 0; dac < 3; dac++) {
+		if (!in[dac])
+			memset(tmp[dac], lut[dac] ? lut[dac][zero] : zero,
+			       NARROW_CHUNK);
+	}
+
+	for (i = 0; i < samples; i += n) {
+		n = samples - i < NARROW_CHUNK ? samples - i : NARROW_CHUNK;
+
+		for (dac = 0; dac < 3; dac++) {
+			src[dac] = tmp[dac];
+
+			if (!in[dac])
+				continue;
+
+			switch (fmt[dac]) {
+			case FL2K_FORMAT_S16:
+				ops->narrow_s16(tmp[dac], (const int16_t *)in[dac] + i, n);
+				break;
+			case FL2K_FORMAT_U16:
+				ops->narrow_u16(tmp[dac], (const uint16_t *)in[dac] + i, n);
+				break;
+			case FL2K_FORMAT_F32:
+				ops->narrow_f32(tmp[dac], (const float *)in[dac] + i, n);
+				break;
+			default:
+				if (sampletype_signed)
+					ops->narrow_s8(tmp[dac], (const char *)in[dac] + i, n);
+				else
+					src[dac] = (const char *)in[dac] + i;
+				break;
+			}
+
+			if (lut[dac]) {
+				ops->lut(tmp[dac], src[dac], n, lut[dac]);
+				src[dac] = tmp[dac];
+			}
+		}
+
+		ops->convert_rgb(out + 3 * i, src[0], src[1], src[2], 3 * n, 0);
+	}
+}
+
+void fl2k_interleave(char *raw_buf, uint32_t raw_len, const char *r_buf,
+		     const char *g_buf, const char *b_buf,
+		     int sampletype_signed)
+{
+	fl2k_convert_select()->convert_rgb(raw_buf, r_buf, g_buf, b_buf,
+					   raw_len,
+					   sampletype_signed ? 128 : 0);
+}
+
+void fl2k_deinterleave(const char *raw_buf, uint32_t raw_len, char *r_buf,
+		       char *g_buf, char *b_buf, int sampletype_signed)
+{
+	fl2k_convert_select()->split_rgb(raw_buf, r_buf, g_buf, b_buf,
+					 raw_len,
+					 sampletype_signed ? 128 : 0);
+}
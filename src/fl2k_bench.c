@@ -0,0 +1,404 @@
+/*
+ * osmo-fl2k, turns FL2000-based USB 3.0 to VGA adapters into
+ * low cost DACs
+ *
+ * Copyright (C) 2016-2018 by Steve Markgraf <steve@steve-m.de>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#define sleep_ms(ms)	usleep(ms*1000)
+#else
+#include <windows.h>
+#include "getopt/getopt.h"
+#define sleep_ms(ms)	Sleep(ms)
+#endif
+
+#include "osmo-fl2k.h"
+#include "convert.h"
+
+enum bench_format {
+	FORMAT_CSV = 0,
+	FORMAT_JSON,
+};
+
+static enum bench_format format = FORMAT_CSV;
+static unsigned int results = 0;
+static uint64_t duration_ns = 1000000000ULL;
+static uint32_t buf_len = FL2K_BUF_LEN;
+
+static char *in_buf[3];
+static char *raw_buf;
+static float *wide_buf;
+
+void usage(void)
+{
+	fprintf(stderr,
+		"fl2k_bench, benchmarks the sample conversion and the transmit "
+		"pipeline of libosmo-fl2k\n\n"
+		"Usage:\n"
+		"\t[-t seconds per benchmark (default: 1)]\n"
+		"\t[-l samples per buffer, multiple of 20480 (default: 1310720)]\n"
+		"\t[-f output format, csv or json (default: csv)]\n\n"
+		"The pipeline is measured with the virtual device, enabled by\n"
+		"setting FL2K_VIRTUAL, which defaults to \"null\" here. It runs\n"
+		"without a sample rate, so the underflows reported are expected.\n\n"
+	);
+	exit(1);
+}
+
+/* monotonic time in nanoseconds */
+static uint64_t get_time_ns(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, cnt;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&cnt);
+
+	return (uint64_t)(cnt.QuadPart / freq.QuadPart) * 1000000000ULL +
+	       (uint64_t)(cnt.QuadPart % freq.QuadPart) * 1000000000ULL /
+	       freq.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static void print_header(void)
+{
+	if (FORMAT_JSON == format)
+		printf("[\n");
+	else
+		printf("benchmark,variant,ops,ns_per_op,mb_per_s\n");
+}
+
+static void print_footer(void)
+{
+	if (FORMAT_JSON == format)
+		printf("%s]\n", results ? "\n" : "");
+}
+
+/* Print the result of ops operations in ns nanoseconds, bytes is the
+ * amount of data per operation, 0 if there is no throughput to report */
+static void print_result(const char *benchmark, const char *variant,
+			 uint64_t ops, uint64_t ns, uint32_t bytes)
+{
+	double ns_per_op = ops ? (double)ns / ops : 0;
+	double mb_per_s = ns ? (double)ops * bytes * 1e3 / ns : 0;
+
+	if (FORMAT_JSON == format) {
+		printf("%s  { \"benchmark\": \"%s\", \"variant\": \"%s\", "
+		       "\"ops\": %llu, \"ns_per_op\": %.1f, \"mb_per_s\": ",
+		       results ? ",\n" : "", benchmark, variant,
+		       (unsigned long long)ops, ns_per_op);
+
+		if (bytes)
+			printf("%.1f }", mb_per_s);
+		else
+			printf("null }");
+	} else {
+		printf("%s,%s,%llu,%.1f,", benchmark, variant,
+		       (unsigned long long)ops, ns_per_op);
+
+		if (bytes)
+			printf("%.1f", mb_per_s);
+
+		printf("\n");
+	}
+
+	results++;
+	fflush(stdout);
+}
+
+/* Conversion of one transfer per operation, with every implementation
+ * usable on this CPU */
+static void bench_convert(void)
+{
+	static const char *dac_names[3] = { "r", "g", "b" };
+	static const char *fmt_names[3] = { "s16", "u16", "f32" };
+	static const uint8_t *const no_lut[3] = { NULL, NULL, NULL };
+	uint8_t lut_buf[256];
+	const fl2k_convert_ops_t *ops;
+	uint32_t xfer_len = buf_len * 3;
+	uint64_t start, ns, n;
+	unsigned int i, k;
+	char variant[32];
+
+	for (i = 0; i < 256; i++)
+		lut_buf[i] = 255 - i;
+
+	for (i = 0; (ops = fl2k_convert_get(i)); i++) {
+		const fl2k_convert_fn_t convert[3] = {
+			ops->convert_r, ops->convert_g, ops->convert_b
+		};
+
+		for (k = 0; k < 3; k++) {
+			start = get_time_ns();
+
+			for (n = 0; (ns = get_time_ns() - start) < duration_ns; n++)
+				convert[k](raw_buf, in_buf[k], xfer_len, 128);
+
+			snprintf(variant, sizeof(variant), "%s_%s",
+				 ops->name, dac_names[k]);
+			print_result("convert", variant, n, ns, xfer_len);
+		}
+
+		start = get_time_ns();
+
+		for (n = 0; (ns = get_time_ns() - start) < duration_ns; n++)
+			ops->convert_rgb(raw_buf, in_buf[0], in_buf[1],
+					 in_buf[2], xfer_len, 128);
+
+		snprintf(variant, sizeof(variant), "%s_rgb", ops->name);
+		print_result("convert", variant, n, ns, xfer_len);
+
+		/* splitting the transfer converted above leaves the input
+		 * buffers unchanged */
+		start = get_time_ns();
+
+		for (n = 0; (ns = get_time_ns() - start) < duration_ns; n++)
+			ops->split_rgb(raw_buf, in_buf[0], in_buf[1],
+				       in_buf[2], xfer_len, 128);
+
+		snprintf(variant, sizeof(variant), "%s_split", ops->name);
+		print_result("convert", variant, n, ns, xfer_len);
+
+		/* all DACs narrowed from wider samples while interleaving */
+		for (k = 0; k < 3; k++) {
+			const void *in[3] = { wide_buf, wide_buf, wide_buf };
+			int fmt[3];
+
+			fmt[0] = fmt[1] = fmt[2] = FL2K_FORMAT_S16 + k;
+			start = get_time_ns();
+
+			for (n = 0; (ns = get_time_ns() - start) < duration_ns; n++)
+				fl2k_convert_formats(ops, raw_buf, in, fmt, no_lut,
+						     1, xfer_len);
+
+			snprintf(variant, sizeof(variant), "%s_%s",
+				 ops->name, fmt_names[k]);
+			print_result("convert", variant, n, ns, xfer_len);
+		}
+
+		/* 8 bit samples of all DACs mapped through a table */
+		{
+			const void *in[3] = { in_buf[0], in_buf[1], in_buf[2] };
+			const uint8_t *lut[3] = { lut_buf, lut_buf, lut_buf };
+			int fmt[3] = { 0, 0, 0 };
+
+			start = get_time_ns();
+
+			for (n = 0; (ns = get_time_ns() - start) < duration_ns; n++)
+				fl2k_convert_formats(ops, raw_buf, in, fmt, lut,
+						     1, xfer_len);
+
+			snprintf(variant, sizeof(variant), "%s_lut", ops->name);
+			print_result("convert", variant, n, ns, xfer_len);
+		}
+	}
+}
+
+static int open_virtual(fl2k_dev_t **dev)
+{
+	uint32_t cnt = fl2k_get_device_count();
+
+	/* the virtual device is listed after the real ones */
+	if (!cnt || fl2k_open(dev, cnt - 1) < 0 ||
+	    strcmp(fl2k_get_device_name(cnt - 1), "Virtual FL2K")) {
+		fprintf(stderr, "Failed to open the virtual device.\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Setting the sample rate, the first call includes building the table
+ * of PLL settings */
+static int bench_sample_rate(void)
+{
+	fl2k_dev_t *dev = NULL;
+	const double *rates;
+	uint32_t num, i = 0;
+	uint64_t start, ns, n;
+
+	if (open_virtual(&dev) < 0)
+		return -1;
+
+	start = get_time_ns();
+	fl2k_set_sample_rate(dev, 100000000);
+	print_result("sample_rate", "first", 1, get_time_ns() - start, 0);
+
+	num = fl2k_list_sample_rates(&rates);
+	if (!num) {
+		fl2k_close(dev);
+		return -1;
+	}
+
+	/* spread the requested rates over the whole table */
+	start = get_time_ns();
+
+	for (n = 0; (ns = get_time_ns() - start) < duration_ns; n++) {
+		i = (i + 7919) % num;
+		fl2k_set_sample_rate(dev, (uint32_t)rates[i]);
+	}
+
+	print_result("sample_rate", "lookup", n, ns, 0);
+	fl2k_close(dev);
+
+	return 0;
+}
+
+static void pipeline_callback(fl2k_data_info_t *data_info)
+{
+	if (data_info->device_error)
+		return;
+
+	data_info->sampletype_signed = 1;
+	data_info->r_buf = in_buf[0];
+	data_info->g_buf = in_buf[1];
+	data_info->b_buf = in_buf[2];
+}
+
+/* Callbacks, conversion and submission of transfers against the virtual
+ * device. Without a sample rate set, it completes the transfers as soon
+ * as they are submitted, so that the pipeline is the bottleneck. */
+static int bench_pipeline(void)
+{
+	fl2k_dev_t *dev = NULL;
+	fl2k_stats_t base, stats;
+	uint64_t start, ns;
+	int r;
+
+	if (open_virtual(&dev) < 0)
+		return -1;
+
+	r = fl2k_set_buffer_len(dev, buf_len);
+	if (r < 0)
+		goto out;
+
+	r = fl2k_start_tx(dev, pipeline_callback, NULL, 0);
+	if (r < 0)
+		goto out;
+
+	/* leave out the allocation and the start of the threads */
+	r = fl2k_get_stats(dev, &base);
+	start = get_time_ns();
+
+	/* usleep() may refuse to sleep for a second or longer */
+	while (r >= 0 && get_time_ns() - start < duration_ns)
+		sleep_ms(10);
+
+	if (r >= 0)
+		r = fl2k_get_stats(dev, &stats);
+	ns = get_time_ns() - start;
+	fl2k_stop_tx(dev);
+
+	if (r >= 0)
+		print_result("pipeline", "callback_rgb",
+			     stats.cb_count - base.cb_count, ns, buf_len * 3);
+
+out:
+	fl2k_close(dev);
+
+	return r;
+}
+
+int main(int argc, char **argv)
+{
+	int opt, i, r = 0;
+	double seconds;
+
+	while ((opt = getopt(argc, argv, "t:l:f:")) != -1) {
+		switch (opt) {
+		case 't':
+			seconds = atof(optarg);
+			if (seconds <= 0)
+				usage();
+			duration_ns = (uint64_t)(seconds * 1e9);
+			break;
+		case 'l':
+			buf_len = (uint32_t)atoi(optarg);
+			if (!buf_len || buf_len > FL2K_BUF_LEN ||
+			    buf_len % FL2K_BUF_LEN_MIN)
+				usage();
+			break;
+		case 'f':
+			if (!strcmp(optarg, "json"))
+				format = FORMAT_JSON;
+			else if (!strcmp(optarg, "csv"))
+				format = FORMAT_CSV;
+			else
+				usage();
+			break;
+		default:
+			usage();
+			break;
+		}
+	}
+
+#ifdef _WIN32
+	if (!getenv("FL2K_VIRTUAL"))
+		_putenv_s("FL2K_VIRTUAL", "null");
+#else
+	setenv("FL2K_VIRTUAL", "null", 0);
+#endif
+
+	raw_buf = malloc(buf_len * 3);
+	wide_buf = calloc(buf_len, sizeof(float));
+	for (i = 0; i < 3; i++) {
+		in_buf[i] = malloc(buf_len);
+		if (in_buf[i])
+			memset(in_buf[i], 0x55 * i, buf_len);
+	}
+
+	if (!raw_buf || !wide_buf || !in_buf[0] || !in_buf[1] || !in_buf[2]) {
+		fprintf(stderr, "malloc error!\n");
+		r = -ENOMEM;
+		goto out;
+	}
+
+	print_header();
+	bench_convert();
+
+	if (bench_sample_rate() < 0)
+		r = 1;
+
+	if (bench_pipeline() < 0)
+		r = 1;
+
+	print_footer();
+
+out:
+	for (i = 0; i < 3; i++)
+		free(in_buf[i]);
+
+	free(raw_buf);
+	free(wide_buf);
+
+	return r;
+}
@@ -38,6 +38,7 @@
 #endif
 
 #include "osmo-fl2k.h"
+#include "thread_opts.h"
 
 static fl2k_dev_t *dev = NULL;
 
@@ -45,6 +46,7 @@ static volatile int do_exit = 0;
 static volatile int repeat = 1;
 FILE *file;
 char *txbuf = NULL;
+static thread_opts_t thread_opts;
 
 void usage(void)
 {
@@ -54,6 +56,8 @@ void usage(void)
 		"\t[-d device_index (default: 0)]\n"
 		"\t[-r repeat file (default: 1)]\n"
 		"\t[-s samplerate (default: 100 MS/s)]\n"
+		"\t[-l samples per buffer, multiple of 20480 (default: 1310720)]\n"
+		THREAD_OPTS_USAGE
 		"\tfilename (use '-' to read from stdin)\n\n"
 	);
 	exit(1);
@@ -82,7 +86,7 @@ static void sighandler(int signum)
 
 void fl2k_callback(fl2k_data_info_t *data_info)
 {
-	int r, left = FL2K_BUF_LEN;
+	int r, left = data_info->len;
 	static uint32_t repeat_cnt = 0;
 
 	if (data_info->device_error) {
@@ -95,7 +99,7 @@ void fl2k_callback(fl2k_data_info_t *data_info)
 	data_info->r_buf = txbuf;
 
 	while (!do_exit && (left > 0)) {
-		r = fread(txbuf + (FL2K_BUF_LEN - left), 1, left, file);
+		r = fread(txbuf + (data_info->len - left), 1, left, file);
 
 		if (ferror(file))
 			fprintf(stderr, "File Error\n");
@@ -124,11 +128,12 @@ int main(int argc, char **argv)
 	int r, opt, i;
 	uint32_t samp_rate = 100000000;
 	uint32_t buf_num = 0;
+	uint32_t buf_len = FL2K_BUF_LEN;
 	int dev_index = 0;
 	void *status;
 	char *filename = NULL;
 
-	while ((opt = getopt(argc, argv, "d:r:s:")) != -1) {
+	while ((opt = getopt(argc, argv, "d:r:s:l:" THREAD_OPTS)) != -1) {
 		switch (opt) {
 		case 'd':
 			dev_index = (uint32_t)atoi(optarg);
@@ -139,6 +144,15 @@ int main(int argc, char **argv)
 		case 's':
 			samp_rate = (uint32_t)atof(optarg);
 			break;
+		case 'l':
+			buf_len = (uint32_t)atoi(optarg);
+			break;
+		case 'P':
+		case 'N':
+		case 'A':
+			if (thread_opts_parse(&thread_opts, opt, optarg) < 0)
+				usage();
+			break;
 		default:
 			usage();
 			break;
@@ -178,6 +192,15 @@ int main(int argc, char **argv)
 		goto out;
 	}
 
+	if (fl2k_set_buffer_len(dev, buf_len) < 0) {
+		fprintf(stderr, "Invalid buffer length, needs to be a multiple "
+			"of %d up to %d.\n", FL2K_BUF_LEN_MIN, FL2K_BUF_LEN);
+		goto out;
+	}
+
+	if (thread_opts_apply(&thread_opts, dev) < 0)
+		goto out;
+
 	r = fl2k_start_tx(dev, fl2k_callback, NULL, 0);
 
 	/* Set the sample rate */
@@ -45,6 +45,7 @@
 
 #include "osmo-fl2k.h"
 #include "rds_mod.h"
+#include "thread_opts.h"
 
 #define BUFFER_SAMPLES_SHIFT	16
 #define BUFFER_SAMPLES		(1 << BUFFER_SAMPLES_SHIFT)
@@ -56,18 +57,15 @@ fl2k_dev_t *dev = NULL;
 int do_exit = 0;
 
 pthread_t fm_thread;
-pthread_mutex_t cb_mutex;
 pthread_mutex_t fm_mutex;
-pthread_cond_t cb_cond;
 pthread_cond_t fm_cond;
 
 FILE *file;
-int8_t *txbuf = NULL;
 int8_t *fmbuf = NULL;
-int8_t *buf1 = NULL;
-int8_t *buf2 = NULL;
 
-uint32_t samp_rate = 100000000;
+double samp_rate = 100000000;
+uint32_t buf_len = FL2K_BUF_LEN;
+int underflow_policy = FL2K_UNDERFLOW_SILENCE;
 
 /* default signal parameters */
 #define PILOT_FREQ	19000	/* In Hz */
@@ -75,10 +73,11 @@ uint32_t samp_rate = 100000000;
 
 int delta_freq = 75000;
 int carrier_freq = 97000000;
-int carrier_per_signal;
+double carrier_per_signal;
 int input_freq = 44100;
 int stereo_flag = 0;
 int rds_flag = 0;
+thread_opts_t thread_opts;
 
 double *freqbuf; 
 double *slopebuf; 
@@ -94,8 +93,11 @@ void usage(void)
 		"\t[-f FM deviation (default: 75000 Hz, WBFM)]\n"
 		"\t[-i input audio sample rate (default: 44100 Hz for mono FM)]\n"
 		"\t[-s samplerate in Hz (default: 100 MS/s)]\n"
+		"\t[-u underflow policy: repeat, silence or hold (default: silence)]\n"
+		"\t[-l samples per buffer, multiple of 20480 (default: 1310720)]\n"
 		"\t[--rds (enables RDS, forces audio sample rate to 228 kHz)]\n"
 		"\t[--stereo (enables stereo, requires audio sample rate >= 114 kHz)]\n"
+		THREAD_OPTS_USAGE
 		"\tfilename (use '-' to read from stdin)\n\n"
 	);
 	exit(1);
@@ -225,10 +227,12 @@ static void *fm_worker(void *arg)
 	register double freq;
 	register double tmp;
 	dds_t carrier;
-	int8_t *tmp_ptr;
+	char *xfer_buf;
 	uint32_t len = 0;
 	uint32_t readlen, remaining;
-	int buf_prefilled = 0;
+	uint32_t carrier_len;
+	double carrier_acc = 0;
+	int r;
 
 	/* Prepare the oscillators */
 	carrier = dds_init(samp_rate, carrier_freq, 0);
@@ -238,27 +242,38 @@ static void *fm_worker(void *arg)
 		readpos++;
 		readpos &= BUFFER_SAMPLES_MASK;
 
+		/* The sample rate is no integer multiple of the audio rate,
+		 * carry the fraction over so that they don't drift apart */
+		carrier_acc += carrier_per_signal;
+		carrier_len = (uint32_t)carrier_acc;
+		carrier_acc -= carrier_len;
+
 		/* check if we reach the end of the buffer */
-		if ((len + carrier_per_signal) > FL2K_BUF_LEN) {
-			readlen = FL2K_BUF_LEN - len;
-			remaining = carrier_per_signal - readlen;
+		if ((len + carrier_len) > buf_len) {
+			readlen = buf_len - len;
+			remaining = carrier_len - readlen;
 			dds_real_buf(&carrier, &fmbuf[len], readlen);
 
-			if (buf_prefilled) {
-				/* swap buffers */
-				tmp_ptr = fmbuf;
-				fmbuf = txbuf;
-				txbuf = tmp_ptr;
-				pthread_cond_wait(&cb_cond, &cb_mutex);
+			/* hand the samples over to the library, this
+			 * blocks until a transfer buffer is available */
+			r = fl2k_acquire_tx_buffer(dev, &xfer_buf, -1);
+			if (r < 0) {
+				if (r == FL2K_ERROR_NO_DEVICE)
+					fprintf(stderr, "Device error, exiting.\n");
+				do_exit = 1;
+				pthread_cond_signal(&fm_cond);
+				break;
 			}
 
+			fl2k_interleave(xfer_buf, buf_len * 3,
+					(char *)fmbuf, NULL, NULL, 1);
+			fl2k_submit_tx_buffer(dev, xfer_buf);
+
 			dds_real_buf(&carrier, fmbuf, remaining);
 			len = remaining;
-
-			buf_prefilled = 1;
 		} else {
-			dds_real_buf(&carrier, &fmbuf[len], carrier_per_signal);
-			len += carrier_per_signal;
+			dds_real_buf(&carrier, &fmbuf[len], carrier_len);
+			len += carrier_len;
 		}
 
 		pthread_cond_signal(&fm_cond);
@@ -416,20 +431,6 @@ void fm_modulator_stereo(int use_rds)
 	}
 }
 
-void fl2k_callback(fl2k_data_info_t *data_info)
-{
-	if (data_info->device_error) {
-		fprintf(stderr, "Device error, exiting.\n");
-		do_exit = 1;
-		pthread_cond_signal(&fm_cond);
-	}
-
-	pthread_cond_signal(&cb_cond);
-
-	data_info->sampletype_signed = 1;
-	data_info->r_buf = (char *)txbuf;
-}
-
 int main(int argc, char **argv)
 {
 	int r, opt;
@@ -452,7 +453,7 @@ int main(int argc, char **argv)
 	};
 
 	while (1) {
-		opt = getopt_long(argc, argv, "d:c:f:i:s:", long_options, &option_index);
+		opt = getopt_long(argc, argv, "d:c:f:i:s:l:u:" THREAD_OPTS, long_options, &option_index);
 
 		/* end of options reached */
 		if (opt == -1)
@@ -475,7 +476,26 @@ int main(int argc, char **argv)
 			input_freq_specified = 1;
 			break;
 		case 's':
-			samp_rate = (uint32_t)atof(optarg);
+			samp_rate = atof(optarg);
+			break;
+		case 'l':
+			buf_len = (uint32_t)atoi(optarg);
+			break;
+		case 'u':
+			if (!strcmp(optarg, "repeat"))
+				underflow_policy = FL2K_UNDERFLOW_REPEAT;
+			else if (!strcmp(optarg, "silence"))
+				underflow_policy = FL2K_UNDERFLOW_SILENCE;
+			else if (!strcmp(optarg, "hold"))
+				underflow_policy = FL2K_UNDERFLOW_HOLD;
+			else
+				usage();
+			break;
+		case 'P':
+		case 'N':
+		case 'A':
+			if (thread_opts_parse(&thread_opts, opt, optarg) < 0)
+				usage();
 			break;
 		default:
 			usage();
@@ -524,31 +544,25 @@ int main(int argc, char **argv)
 	}
 
 	/* allocate buffer */
-	buf1 = malloc(FL2K_BUF_LEN);
-	buf2 = malloc(FL2K_BUF_LEN);
-	if (!buf1 || !buf2) {
+	fmbuf = malloc(FL2K_BUF_LEN);
+	if (!fmbuf) {
 		fprintf(stderr, "malloc error!\n");
 		exit(1);
 	}
 
-	fmbuf = buf1;
-	txbuf = buf2;
-
 	/* Decoded audio */
 	freqbuf = malloc(BUFFER_SAMPLES * sizeof(double));
 	slopebuf = malloc(BUFFER_SAMPLES * sizeof(double));
 	readpos = 0;
 	writepos = 1;
 
-	fprintf(stderr, "Samplerate:\t%3.2f MHz\n", (double)samp_rate/1000000);
+	fprintf(stderr, "Samplerate:\t%3.2f MHz\n", samp_rate/1000000);
 	fprintf(stderr, "Carrier:\t%3.2f MHz\n", (double)carrier_freq/1000000);
 	fprintf(stderr, "Frequencies:\t%3.2f MHz, %3.2f MHz\n", 
-					(double)((samp_rate - carrier_freq) / 1000000.0),
-					(double)((samp_rate + carrier_freq) / 1000000.0));
+					(samp_rate - carrier_freq) / 1000000.0,
+					(samp_rate + carrier_freq) / 1000000.0);
 
-	pthread_mutex_init(&cb_mutex, NULL);
 	pthread_mutex_init(&fm_mutex, NULL);
-	pthread_cond_init(&cb_cond, NULL);
 	pthread_cond_init(&fm_cond, NULL);
 	pthread_attr_init(&attr);
 
@@ -558,26 +572,46 @@ int main(int argc, char **argv)
 		goto out;
 	}
 
-	r = pthread_create(&fm_thread, &attr, fm_worker, NULL);
-	if (r < 0) {
-		fprintf(stderr, "Error spawning FM worker thread!\n");
+	if (fl2k_set_buffer_len(dev, buf_len) < 0) {
+		fprintf(stderr, "Invalid buffer length, needs to be a multiple "
+			"of %d up to %d.\n", FL2K_BUF_LEN_MIN, FL2K_BUF_LEN);
 		goto out;
 	}
 
-	pthread_attr_destroy(&attr);
-	r = fl2k_start_tx(dev, fl2k_callback, NULL, 0);
+	if (thread_opts_apply(&thread_opts, dev) < 0)
+		goto out;
+
+	if (fl2k_set_underflow_policy(dev, underflow_policy) < 0) {
+		fprintf(stderr, "Invalid underflow policy.\n");
+		goto out;
+	}
+
+	/* no callback, the FM worker pushes the buffers itself */
+	r = fl2k_start_tx(dev, NULL, NULL, 0);
+	if (r < 0) {
+		fprintf(stderr, "Failed to start streaming.\n");
+		goto out;
+	}
 
 	/* Set the sample rate */
-	r = fl2k_set_sample_rate(dev, samp_rate);
+	r = fl2k_set_sample_rate(dev, (uint32_t)samp_rate);
 	if (r < 0)
 		fprintf(stderr, "WARNING: Failed to set sample rate. %d\n", r);
 
 	/* read back actual frequency */
-	samp_rate = fl2k_get_sample_rate(dev);
+	samp_rate = fl2k_get_sample_rate_exact(dev);
 
 	/* Calculate needed constants */
 	carrier_per_signal = samp_rate / input_freq;
 
+	r = pthread_create(&fm_thread, &attr, fm_worker, NULL);
+	if (r < 0) {
+		fprintf(stderr, "Error spawning FM worker thread!\n");
+		goto out;
+	}
+
+	pthread_attr_destroy(&attr);
+
 	/* Set RDS parameters */
 	set_rds_pi(0x0dac);
 	set_rds_ps("fl2k_fm");
@@ -606,6 +640,10 @@ int main(int argc, char **argv)
 		fm_modulator_mono(rds_flag);
 	}
 
+	/* the FM worker has to be done with the device before closing it */
+	fl2k_stop_tx(dev);
+	pthread_join(fm_thread, NULL);
+
 out:
 	fl2k_close(dev);
 
@@ -614,8 +652,7 @@ out:
 
 	free(freqbuf);
 	free(slopebuf);
-	free(buf1);
-	free(buf2);
+	free(fmbuf);
 
 	return 0;
 }
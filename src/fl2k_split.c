@@ -0,0 +1,194 @@
+/*
+ * osmo-fl2k, turns FL2000-based USB 3.0 to VGA adapters into
+ * low cost DACs
+ *
+ * Copyright (C) 2016-2018 by Steve Markgraf <steve@steve-m.de>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#else
+#include <io.h>
+#include <fcntl.h>
+#include "getopt/getopt.h"
+#endif
+
+#include "osmo-fl2k.h"
+
+/* a raw block holds 8 samples of each DAC */
+#define BLOCK_LEN	24
+
+static const char *dac_names[3] = { "red", "green", "blue" };
+
+void usage(void)
+{
+	fprintf(stderr,
+		"fl2k_split, splits raw FL2K transfer data, such as written "
+		"by the virtual device,\ninto the samples of each DAC\n\n"
+		"Usage:\n"
+		"\t[-r red output file]\n"
+		"\t[-g green output file]\n"
+		"\t[-b blue output file]\n"
+		"\t[-S write signed samples (default: unsigned)]\n"
+		"\tfilename (use '-' to read from stdin or write to stdout)\n\n"
+	);
+	exit(1);
+}
+
+static FILE *open_file(const char *filename, int out)
+{
+	FILE *file;
+
+	if (strcmp(filename, "-") == 0) {
+		file = out ? stdout : stdin;
+#ifdef _WIN32
+		_setmode(_fileno(file), _O_BINARY);
+#endif
+		return file;
+	}
+
+	file = fopen(filename, out ? "wb" : "rb");
+	if (!file)
+		fprintf(stderr, "Failed to open %s\n", filename);
+
+	return file;
+}
+
+int main(int argc, char **argv)
+{
+	int opt, i, r = 1;
+	int sampletype_signed = 0;
+	char *filenames[3] = { NULL, NULL, NULL };
+	FILE *out[3] = { NULL, NULL, NULL };
+	char *out_buf[3] = { NULL, NULL, NULL };
+	char *raw_buf = NULL;
+	FILE *file = NULL;
+	size_t len = 0, n, split;
+	uint64_t samples = 0;
+
+	while ((opt = getopt(argc, argv, "r:g:b:S")) != -1) {
+		switch (opt) {
+		case 'r':
+			filenames[0] = optarg;
+			break;
+		case 'g':
+			filenames[1] = optarg;
+			break;
+		case 'b':
+			filenames[2] = optarg;
+			break;
+		case 'S':
+			sampletype_signed = 1;
+			break;
+		default:
+			usage();
+			break;
+		}
+	}
+
+	if (argc <= optind)
+		usage();
+
+	if (!filenames[0] && !filenames[1] && !filenames[2]) {
+		fprintf(stderr, "No output file given.\n");
+		usage();
+	}
+
+	file = open_file(argv[optind], 0);
+	if (!file)
+		return -ENOENT;
+
+	raw_buf = malloc(FL2K_XFER_LEN);
+	if (!raw_buf) {
+		fprintf(stderr, "malloc error!\n");
+		goto out;
+	}
+
+	for (i = 0; i < 3; i++) {
+		if (!filenames[i])
+			continue;
+
+		out[i] = open_file(filenames[i], 1);
+		out_buf[i] = malloc(FL2K_BUF_LEN);
+		if (!out[i] || !out_buf[i])
+			goto out;
+	}
+
+	while (1) {
+		n = fread(raw_buf + len, 1, FL2K_XFER_LEN - len, file);
+		len += n;
+
+		if (ferror(file)) {
+			fprintf(stderr, "File Error\n");
+			goto out;
+		}
+
+		/* only complete blocks can be split, the rest is kept */
+		split = len - (len % BLOCK_LEN);
+
+		if (split) {
+			fl2k_deinterleave(raw_buf, (uint32_t)split, out_buf[0],
+					  out_buf[1], out_buf[2],
+					  sampletype_signed);
+
+			for (i = 0; i < 3; i++) {
+				if (out[i] && fwrite(out_buf[i], 1, split / 3,
+						     out[i]) != split / 3) {
+					fprintf(stderr, "Failed to write %s "
+						"samples\n", dac_names[i]);
+					goto out;
+				}
+			}
+
+			samples += split / 3;
+			len -= split;
+			memmove(raw_buf, raw_buf + split, len);
+		}
+
+		if (!n)
+			break;
+	}
+
+	if (len)
+		fprintf(stderr, "Ignoring %u trailing bytes of an incomplete "
+			"block\n", (unsigned int)len);
+
+	fprintf(stderr, "Split %llu samples per DAC\n",
+		(unsigned long long)samples);
+	r = 0;
+
+out:
+	for (i = 0; i < 3; i++) {
+		if (out[i] && out[i] != stdout)
+			fclose(out[i]);
+
+		free(out_buf[i]);
+	}
+
+	free(raw_buf);
+
+	if (file && (file != stdin))
+		fclose(file);
+
+	return r;
+}
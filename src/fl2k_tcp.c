@@ -45,6 +45,7 @@
 #endif
 
 #include "osmo-fl2k.h"
+#include "thread_opts.h"
 
 #ifdef _WIN32
 #pragma comment(lib, "ws2_32.lib")
@@ -65,6 +66,7 @@ static volatile int connected = 0;
 static char *txbuf = NULL;
 static fd_set readfds;
 static SOCKET sock;
+static thread_opts_t thread_opts;
 
 void usage(void)
 {
@@ -75,6 +77,10 @@ void usage(void)
 		"\t[-p port (default: 1234)]\n"
 		"\t[-s samplerate in Hz (default: 100 MS/s)]\n"
 		"\t[-b number of buffers (default: 4)]\n"
+		"\t[-B maximum number of buffers, adapts to underflows (default: off)]\n"
+		"\t[-u underflow policy: repeat, silence or hold (default: repeat)]\n"
+		"\t[-l samples per buffer, multiple of 20480 (default: 1310720)]\n"
+		THREAD_OPTS_USAGE
 	);
 	exit(1);
 }
@@ -102,7 +108,7 @@ static void sighandler(int signum)
 
 void fl2k_callback(fl2k_data_info_t *data_info)
 {
-	int left = FL2K_BUF_LEN;
+	int left = data_info->len;
 	int received;
 	int r;
 	struct timeval tv = { 1, 0 };
@@ -127,7 +133,7 @@ void fl2k_callback(fl2k_data_info_t *data_info)
 		r = select(sock + 1, &readfds, NULL, NULL, &tv);
 
 		if (r) {
-			received = recv(sock, txbuf + (FL2K_BUF_LEN - left), left, 0);
+			received = recv(sock, txbuf + (data_info->len - left), left, 0);
 			if (!received) {
 				fprintf(stderr, "Connection was closed!\n");
 				fl2k_stop_tx(dev);
@@ -147,6 +153,9 @@ int main(int argc, char **argv)
 	uint32_t samp_rate = 100000000;
 	struct sockaddr_in local, remote;
 	uint32_t buf_num = 0;
+	uint32_t buf_num_max = 0;
+	int underflow_policy = FL2K_UNDERFLOW_REPEAT;
+	uint32_t buf_len = FL2K_BUF_LEN;
 	int dev_index = 0;
 	int dev_given = 0;
 	int flag = 1;
@@ -158,7 +167,7 @@ int main(int argc, char **argv)
 	struct sigaction sigact, sigign;
 #endif
 
-	while ((opt = getopt(argc, argv, "d:s:a:p:b:")) != -1) {
+	while ((opt = getopt(argc, argv, "d:s:a:p:b:B:l:u:" THREAD_OPTS)) != -1) {
 		switch (opt) {
 		case 'd':
 			dev_index = (uint32_t)atoi(optarg);
@@ -176,6 +185,28 @@ int main(int argc, char **argv)
 		case 'b':
 			buf_num = atoi(optarg);
 			break;
+		case 'B':
+			buf_num_max = atoi(optarg);
+			break;
+		case 'u':
+			if (!strcmp(optarg, "repeat"))
+				underflow_policy = FL2K_UNDERFLOW_REPEAT;
+			else if (!strcmp(optarg, "silence"))
+				underflow_policy = FL2K_UNDERFLOW_SILENCE;
+			else if (!strcmp(optarg, "hold"))
+				underflow_policy = FL2K_UNDERFLOW_HOLD;
+			else
+				usage();
+			break;
+		case 'l':
+			buf_len = (uint32_t)atoi(optarg);
+			break;
+		case 'P':
+		case 'N':
+		case 'A':
+			if (thread_opts_parse(&thread_opts, opt, optarg) < 0)
+				usage();
+			break;
 		default:
 			usage();
 			break;
@@ -202,6 +233,25 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (fl2k_set_buffer_len(dev, buf_len) < 0) {
+		fprintf(stderr, "Invalid buffer length, needs to be a multiple "
+			"of %d up to %d.\n", FL2K_BUF_LEN_MIN, FL2K_BUF_LEN);
+		exit(1);
+	}
+
+	if (thread_opts_apply(&thread_opts, dev) < 0)
+		exit(1);
+
+	if (fl2k_set_adaptive_buf_num(dev, buf_num_max) < 0) {
+		fprintf(stderr, "Failed to set the maximum buffer count.\n");
+		exit(1);
+	}
+
+	if (fl2k_set_underflow_policy(dev, underflow_policy) < 0) {
+		fprintf(stderr, "Invalid underflow policy.\n");
+		exit(1);
+	}
+
 	r = fl2k_start_tx(dev, fl2k_callback, NULL, buf_num);
 
 	/* Set the sample rate */
@@ -33,12 +33,6 @@
 #include <stdlib.h>
 #include <math.h>
 
-#ifdef __APPLE__
-#include <sys/time.h>
-#else
-#include <time.h>
-#endif
-
 #ifndef _WIN32
 #include <unistd.h>
 #define sleep_ms(ms)	usleep(ms*1000)
@@ -49,24 +43,17 @@
 #endif
 
 #include "osmo-fl2k.h"
+#include "thread_opts.h"
 
 #define DEFAULT_SAMPLE_RATE		100000000
 #define PPM_DURATION			10
 #define PPM_DUMP_TIME			1
+#define STALL_TIMEOUT_MS		2000
 
 struct time_generic
-	/* holds all the platform specific values */
 {
-#ifndef _WIN32
-	time_t tv_sec;
-	long tv_nsec;
-#else
-	long tv_sec;
+	int64_t tv_sec;
 	long tv_nsec;
-	int init;
-	LARGE_INTEGER frequency;
-	LARGE_INTEGER ticks;
-#endif
 };
 
 static int do_exit = 0;
@@ -76,7 +63,8 @@ static uint32_t samp_rate = DEFAULT_SAMPLE_RATE;
 static unsigned int ppm_duration = PPM_DURATION;
 
 static char *buffer;
-static int cb_cnt = 0;
+static char *raw_buf;
+static thread_opts_t thread_opts;
 
 void usage(void)
 {
@@ -86,6 +74,7 @@ void usage(void)
 		"Usage:\n"
 		"\t[-d device_index (default: 0)]\n"
 		"\t[-s samplerate (default: 100 MS/s)]\n"
+		THREAD_OPTS_USAGE
 	);
 	exit(1);
 }
@@ -111,44 +100,6 @@ static void sighandler(int signum)
 }
 #endif
 
-#ifndef _WIN32
-static int ppm_gettime(struct time_generic *tg)
-{
-	int rv = ENOSYS;
-	struct timespec ts;
-
-#ifdef __unix__
-	rv = clock_gettime(CLOCK_MONOTONIC, &ts);
-	tg->tv_sec = ts.tv_sec;
-	tg->tv_nsec = ts.tv_nsec;
-#elif __APPLE__
-	struct timeval tv;
-
-	rv = gettimeofday(&tv, NULL);
-	tg->tv_sec = tv.tv_sec;
-	tg->tv_nsec = tv.tv_usec * 1000;
-#endif
-	return rv;
-}
-#endif
-
-#ifdef _WIN32
-static int ppm_gettime(struct time_generic *tg)
-{
-	int rv;
-	int64_t frac;
-	if (!tg->init) {
-		QueryPerformanceFrequency(&tg->frequency);
-		tg->init = 1;
-	}
-	rv = QueryPerformanceCounter(&tg->ticks);
-	tg->tv_sec = tg->ticks.QuadPart / tg->frequency.QuadPart;
-	frac = (int64_t)(tg->ticks.QuadPart - (tg->tv_sec * tg->frequency.QuadPart));
-	tg->tv_nsec = (long)(frac * 1000000000L / (int64_t)tg->frequency.QuadPart);
-	return !rv;
-}
-#endif
-
 static int ppm_report(uint64_t nsamples, uint64_t interval)
 {
 	double real_rate, ppm;
@@ -158,7 +109,7 @@ static int ppm_report(uint64_t nsamples, uint64_t interval)
 	return (int)round(ppm);
 }
 
-static void ppm_test(uint32_t len)
+static void ppm_test(uint64_t len, uint64_t timestamp_ns)
 {
 	static uint64_t nsamples = 0;
 	static uint64_t interval = 0;
@@ -173,7 +124,8 @@ static void ppm_test(uint32_t len)
 		PPM_INIT_RUN
 	} ppm_init = PPM_INIT_NO;
 
-	ppm_gettime(&ppm_now);
+	ppm_now.tv_sec = timestamp_ns / 1000000000ULL;
+	ppm_now.tv_nsec = timestamp_ns % 1000000000ULL;
 
 	if (ppm_init != PPM_INIT_RUN) {
 		/*
@@ -194,7 +146,7 @@ static void ppm_test(uint32_t len)
 		ppm_init = PPM_INIT_RUN;
 		return;
 	}
-	nsamples += (uint64_t)len;
+	nsamples += len;
 	interval = (uint64_t)(ppm_now.tv_sec - ppm_recent.tv_sec);
 	if (interval < ppm_duration)
 		return;
@@ -211,25 +163,6 @@ static void ppm_test(uint32_t len)
 	nsamples = 0;
 }
 
-void fl2k_callback(fl2k_data_info_t *data_info)
-{
-	if (data_info->device_error) {
-		fprintf(stderr, "Device error, exiting.\n");
-		do_exit = 1;
-		return;
-	}
-
-	/* drop first couple of callbacks until everything is settled */
-	if (cb_cnt > 20) {
-		ppm_test(FL2K_BUF_LEN);
-	} else {
-		/* as data is repetitive, it only needs to be handed
-		 * over until all transfer buffers contain the data */
-		data_info->r_buf = buffer;
-		cb_cnt++;
-	}
-}
-
 int main(int argc, char **argv)
 {
 #ifndef _WIN32
@@ -237,8 +170,10 @@ int main(int argc, char **argv)
 #endif
 	int r, opt, i;
 	uint32_t dev_index = 0;
+	uint64_t count, last_count = 0, timestamp;
+	unsigned int stalled_ms = 0;
 
-	while ((opt = getopt(argc, argv, "d:s:p::h")) != -1) {
+	while ((opt = getopt(argc, argv, "d:s:p::h" THREAD_OPTS)) != -1) {
 		switch (opt) {
 		case 'd':
 			dev_index = (uint32_t)atoi(optarg);
@@ -250,6 +185,12 @@ int main(int argc, char **argv)
 			if (optarg)
 				ppm_duration = atoi(optarg);
 			break;
+		case 'P':
+		case 'N':
+		case 'A':
+			if (thread_opts_parse(&thread_opts, opt, optarg) < 0)
+				usage();
+			break;
 		case 'h':
 		default:
 			usage();
@@ -258,7 +199,8 @@ int main(int argc, char **argv)
 	}
 
 	buffer = malloc(FL2K_BUF_LEN);
-	if (!buffer)
+	raw_buf = malloc(FL2K_XFER_LEN);
+	if (!buffer || !raw_buf)
 		goto exit;
 
 	fl2k_open(&dev, (uint32_t)dev_index);
@@ -267,6 +209,9 @@ int main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (thread_opts_apply(&thread_opts, dev) < 0)
+		goto exit;
+
 #ifndef _WIN32
 	sigact.sa_handler = sighandler;
 	sigemptyset(&sigact.sa_mask);
@@ -285,7 +230,14 @@ int main(int argc, char **argv)
 		buffer[i+1] = 0xff;
 	}
 
-	r = fl2k_start_tx(dev, fl2k_callback, NULL, 0);
+	/* the same buffer is sent over and over again */
+	fl2k_interleave(raw_buf, FL2K_XFER_LEN, buffer, NULL, NULL, 0);
+
+	r = fl2k_start_tx_loop(dev, raw_buf, 1, 0);
+	if (r < 0) {
+		fprintf(stderr, "Failed to start streaming.\n");
+		goto exit;
+	}
 
 	/* Set the sample rate */
 	r = fl2k_set_sample_rate(dev, samp_rate);
@@ -297,12 +249,44 @@ int main(int argc, char **argv)
 	fprintf(stderr, "Reporting PPM error measurement every %u seconds...\n", ppm_duration);
 	fprintf(stderr, "Press ^C after a few minutes.\n");
 
-	while (!do_exit)
-		sleep_ms(500);
+	while (!do_exit) {
+		sleep_ms(5);
+
+		if (fl2k_get_sample_count(dev, &count, &timestamp) < 0)
+			break;
+
+		/* streaming stops by itself if the device was lost */
+		if (!fl2k_get_buf_num(dev)) {
+			fprintf(stderr, "Device error, exiting.\n");
+			break;
+		}
+
+		if (count == last_count) {
+			stalled_ms += 5;
+			if (stalled_ms >= STALL_TIMEOUT_MS) {
+				fprintf(stderr, "Device stopped sending, "
+						"exiting.\n");
+				fl2k_stop_tx(dev);
+				break;
+			}
+			continue;
+		}
+		stalled_ms = 0;
+
+		/* drop first couple of transfers until everything is settled */
+		if (count <= 20 * FL2K_BUF_LEN) {
+			last_count = count;
+			continue;
+		}
+
+		ppm_test(count - last_count, timestamp);
+		last_count = count;
+	}
 
 exit:
 	fl2k_close(dev);
 	free(buffer);
+	free(raw_buf);
 
 	return 0;
 }
@@ -20,20 +20,32 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#ifdef __linux__
+#define _GNU_SOURCE	/* pthread_setaffinity_np() */
+#endif
+
 #include <errno.h>
 #include <signal.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <time.h>
 #include <libusb.h>
 #include <pthread.h>
+#include <sched.h>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
 
 #ifndef _WIN32
 #include <unistd.h>
 #define sleep_ms(ms)	usleep(ms*1000)
 #else
 #include <windows.h>
+#include <sys/timeb.h>
 #define sleep_ms(ms)	Sleep(ms)
 #endif
 
@@ -54,6 +66,8 @@
 #endif
 
 #include "osmo-fl2k.h"
+#include "convert.h"
+#include "virtual.h"
 
 enum fl2k_async_status {
 	FL2K_INACTIVE = 0,
@@ -61,32 +75,127 @@ enum fl2k_async_status {
 	FL2K_RUNNING
 };
 
-typedef enum fl2k_buf_state {
-	BUF_EMPTY = 0,
-	BUF_SUBMITTED,
-	BUF_FILLED,
-} fl2k_buf_state_t;
+/* The ring indices are shared between the USB and the sample worker
+ * thread, each of them only ever written by one side. The same goes for
+ * the statistics, which are only written by the thread they describe.
+ * The state of a device is accessed sequentially consistent, as it is
+ * checked against the transfer counts by the other threads. */
+#if defined(_MSC_VER)
+#include <intrin.h>
+static __inline uint32_t fl2k_load_acquire(volatile uint32_t *p)
+{
+	uint32_t v = *p;
+	_ReadWriteBarrier();
+	return v;
+}
+#define fl2k_store_release(p, v)	\
+	do { _ReadWriteBarrier(); *(volatile uint32_t *)(p) = (v); } while (0)
+#define fl2k_load_acquire64(p)		\
+	((uint64_t)InterlockedCompareExchange64((volatile LONG64 *)(p), 0, 0))
+#define fl2k_store_release64(p, v)	\
+	InterlockedExchange64((volatile LONG64 *)(p), (LONG64)(v))
+#define fl2k_load_seq(p)		\
+	((uint32_t)InterlockedCompareExchange((volatile LONG *)(p), 0, 0))
+#define fl2k_store_seq(p, v)		\
+	InterlockedExchange((volatile LONG *)(p), (LONG)(v))
+#define fl2k_fetch_add(p, v)		\
+	((uint32_t)InterlockedExchangeAdd((volatile LONG *)(p), (LONG)(v)))
+#define fl2k_fetch_add64(p, v)		\
+	((uint64_t)InterlockedExchangeAdd64((volatile LONG64 *)(p), \
+					    (LONG64)(v)))
+#define fl2k_cas(p, old, v)		\
+	((uint32_t)InterlockedCompareExchange((volatile LONG *)(p), \
+					      (LONG)(v), (LONG)(old)) == (old))
+#define fl2k_fence()			MemoryBarrier()
+#else
+#define fl2k_load_acquire(p)		__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define fl2k_store_release(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define fl2k_load_acquire64(p)		fl2k_load_acquire(p)
+#define fl2k_store_release64(p, v)	fl2k_store_release(p, v)
+#define fl2k_load_seq(p)		__atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define fl2k_store_seq(p, v)		__atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define fl2k_fetch_add(p, v)		\
+	__atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+#define fl2k_fetch_add64(p, v)		fl2k_fetch_add(p, v)
+#define fl2k_fence()			__atomic_thread_fence(__ATOMIC_SEQ_CST)
+static inline int fl2k_cas(uint32_t *p, uint32_t old, uint32_t v)
+{
+	return __atomic_compare_exchange_n(p, &old, v, 0, __ATOMIC_SEQ_CST,
+					   __ATOMIC_SEQ_CST);
+}
+#endif
+
+/* Single producer, single consumer ring of transfer indices */
+typedef struct fl2k_xfer_ring {
+	uint32_t *idx;
+	uint32_t mask;
+	uint32_t head;		/* only written by the producer */
+	uint32_t tail;		/* only written by the consumer */
+} fl2k_xfer_ring_t;
 
 typedef struct fl2k_xfer_info {
 	fl2k_dev_t *dev;
-	uint64_t seq;
-	fl2k_buf_state_t state;
+	uint32_t idx;
+	uint64_t submit_time;
+	uint64_t tick;			/* first sample, counted since start */
+	uint64_t target_tick;		/* not to be sent before this sample */
+	int timed;			/* target_tick was requested */
+	uint32_t acquired;		/* held by fl2k_acquire_tx_buffer() */
 } fl2k_xfer_info_t;
 
+typedef struct fl2k_thread_cfg {
+	int set;
+	int policy;
+	int priority;
+	int nice;
+	uint64_t cpu_mask;
+} fl2k_thread_cfg_t;
+
+#define FL2K_THREAD_NUM		2
+
 struct fl2k_dev {
 	libusb_context *ctx;
 	struct libusb_device_handle *devh;
+	fl2k_virtual_t *virt;		/* emulated device, without devh */
 	uint32_t xfer_num;
 	uint32_t xfer_buf_num;
 	uint32_t xfer_buf_len;
+	uint32_t buf_len;		/* samples per DAC for the next start */
 	struct libusb_transfer **xfer;
 	unsigned char **xfer_buf;
 
 	fl2k_xfer_info_t *xfer_info;
+	fl2k_xfer_ring_t filled;	/* sample worker -> USB worker */
+	fl2k_xfer_ring_t empty;		/* USB worker -> sample worker */
+	fl2k_xfer_ring_t spare;		/* parked by the adaptive depth, only
+					 * used by the USB worker */
+	fl2k_xfer_ring_t done;		/* USB event thread -> USB worker */
+
+	/* transfers sent on underflows, following the data transfers in
+	 * xfer[], all of them sending fill_buf[fill_cur]. The other buffer
+	 * is only allocated for holding the samples and rewritten once none
+	 * of its transfers is in flight, as they may be sent from it until
+	 * they complete. */
+	int underflow_policy;
+	uint32_t fill_xfer_num;
+	unsigned char *fill_buf[2];
+	uint32_t fill_cur;		/* only used by the USB worker */
+	uint32_t fill_busy[2];		/* transfers in flight per buffer,
+					 * only used by the USB worker */
+	fl2k_xfer_ring_t fill;		/* only used by the USB worker */
+	uint32_t last_submitted;
+	uint64_t submit_tick;		/* sample the next submission starts
+					 * at */
+	fl2k_tx_done_hook_t tx_done_hook;
+	void *tx_done_ctx;
 
 	fl2k_tx_cb_t cb;
 	void *cb_ctx;
-	enum fl2k_async_status async_status;
+	const char *loop_buf;		/* only valid while starting */
+	uint32_t loop_xfers;		/* transfers in loop, 0 if not looping */
+	uint32_t buf_num_max;		/* adaptive depth ceiling, 0 if fixed */
+	uint32_t xfer_depth_max;	/* ceiling in effect while streaming */
+	uint32_t async_status;		/* enum fl2k_async_status */
 	int async_cancel;
 
 	int use_zerocopy;
@@ -98,10 +207,79 @@ struct fl2k_dev {
 	pthread_mutex_t buf_mutex;
 	pthread_cond_t buf_cond;
 
-	double rate; /* Hz */
+	/* scheduling of the threads above, protected by buf_mutex */
+	fl2k_thread_cfg_t thread_cfg[FL2K_THREAD_NUM];
+	int thread_running[FL2K_THREAD_NUM];
+	pthread_t thread_self[FL2K_THREAD_NUM];
+	long thread_tid[FL2K_THREAD_NUM];
+
+	/* Completions of a routed device are handed from the USB event
+	 * thread to its USB worker through done, usb_mutex is only taken
+	 * for signalling if the USB worker is waiting. */
+	int routed;
+	int cancel_sent;		/* only used by the USB worker */
+	pthread_mutex_t usb_mutex;
+	pthread_cond_t usb_cond;
+	uint32_t usb_waiting;
+	uint32_t routing;		/* event thread in _libusb_callback() */
+
+	/* sample worker wakeups, protected by buf_mutex. The USB worker
+	 * only takes it for signalling if a producer is waiting. */
+	uint32_t worker_waiting;
+	uint32_t xfer_acquired;		/* transfers owned by sample producers,
+					 * changed without the mutex */
+	uint32_t acquiring;		/* a thread pops empty in push mode */
+	uint32_t submitting;		/* a thread pushes filled in push mode */
+	uint64_t wakeup_signal_time;
+	uint64_t wakeup_cnt;
+	uint64_t wakeup_lat_sum;
+	uint64_t wakeup_lat_max;
+
+	/* USB event thread and worker pool, see fl2k_set_shared_threads() */
+	int pooled;			/* serviced by them, set when opening */
+	uint32_t shared;		/* listed in pool_devs */
+	struct fl2k_dev *pool_next;
+	int pool_busy;			/* a pool worker is filling a transfer */
+	int pool_cancelled;		/* all transfers have been cancelled */
+	enum fl2k_async_status pool_next_status;
+	uint32_t underflows;		/* underflows reported so far */
+
+	/* completed transfers and statistics, written by the USB worker
+	 * or the sample producer without locking */
+	uint64_t xfer_done;
+	uint64_t xfer_done_time;
+	uint64_t first_done_time;
+	uint32_t xfer_in_flight;
+	uint32_t xfer_depth;		/* transfers to keep in flight */
+	uint64_t depth_change_time;
+	uint64_t usb_lat_sum;
+	uint64_t usb_lat_max;
+	uint64_t cb_cnt;
+	uint64_t cb_sum;
+	uint64_t cb_min;
+	uint64_t cb_max;
+	uint64_t cb_hist[FL2K_STATS_HIST_BINS];
+	uint64_t conv_cnt;
+	uint64_t conv_sum;
+	uint64_t conv_max;
+	uint64_t deadline_misses;
+	int64_t worst_slack;
+	fl2k_deadline_hook_t deadline_hook;
+	void *deadline_ctx;
+
+	/* DAC tables staged by fl2k_set_dac_lut(), protected by buf_mutex
+	 * and taken over by the sample producer before the next buffer */
+	uint8_t lut_next[3][256];
+	int lut_next_set[3];
+	uint32_t lut_pending;
+	uint8_t lut[3][256];		/* only used by the sample producer */
+	int lut_set[3];
+
+	uint32_t pll_setting;		/* index in pll_rates + 1, 0 if unset,
+					 * read by the library threads */
 
 	/* status */
-	int dev_lost;
+	uint32_t dev_lost;
 	int driver_active;
 	uint32_t underflow_cnt;
 };
@@ -131,8 +309,14 @@ static int fl2k_read_reg(fl2k_dev_t *dev, uint16_t reg, uint32_t *val)
 	if (!dev || !val)
 		return FL2K_ERROR_INVALID_PARAM;
 
-	r = libusb_control_transfer(dev->devh, CTRL_IN, 0x40,
-				    0, reg, data, 4, CTRL_TIMEOUT);
+	/* the virtual device has no registers */
+	if (dev->virt) {
+		memset(data, 0, sizeof(data));
+		r = sizeof(data);
+	} else {
+		r = libusb_control_transfer(dev->devh, CTRL_IN, 0x40,
+					    0, reg, data, 4, CTRL_TIMEOUT);
+	}
 
 	if (r < 4)
 		fprintf(stderr, "Error, short read from register!\n");
@@ -154,6 +338,9 @@ static int fl2k_write_reg(fl2k_dev_t *dev, uint16_t reg, uint32_t val)
 	data[2] = (val >> 16) & 0xff;
 	data[3] = (val >> 24) & 0xff;
 
+	if (dev->virt)
+		return sizeof(data);
+
 	return libusb_control_transfer(dev->devh, CTRL_OUT, 0x41,
 				       0, reg, data, 4, CTRL_TIMEOUT);
 }
@@ -225,48 +412,145 @@ static double fl2k_reg_to_freq(uint32_t reg)
 	return sample_clock;
 }
 
-int fl2k_set_sample_rate(fl2k_dev_t *dev, uint32_t target_freq)
+/* Output divider (accepts value 1-15) works, but adds lots of phase
+ * noise, so do not use it. Only the PLL multiplier, divider and
+ * fractional part are varied. */
+#define PLL_MULT_MIN		3
+#define PLL_MULT_MAX		6
+#define PLL_DIV_MIN		2
+#define PLL_DIV_MAX		63
+#define PLL_FRAC_MAX		15
+#define PLL_TABLE_SIZE		((PLL_MULT_MAX - PLL_MULT_MIN + 1) * \
+				 (PLL_DIV_MAX - PLL_DIV_MIN + 1) * PLL_FRAC_MAX)
+
+typedef struct fl2k_pll_setting {
+	double rate;
+	uint32_t reg;
+	uint32_t pref;		/* lower is preferred for identical rates */
+} fl2k_pll_setting_t;
+
+/* all achievable sample rates, sorted and without duplicates */
+static double pll_rates[PLL_TABLE_SIZE];
+static uint32_t pll_regs[PLL_TABLE_SIZE];
+static uint32_t pll_num;
+static pthread_once_t pll_once = PTHREAD_ONCE_INIT;
+
+static int fl2k_pll_cmp(const void *a, const void *b)
 {
-	double sample_clock, error, last_error = 1e20f;
-	uint32_t reg = 0, result_reg = 0;
-	uint8_t div, mult, frac, out_div;
+	const fl2k_pll_setting_t *x = a, *y = b;
 
-	if (!dev)
-		return FL2K_ERROR_INVALID_PARAM;
+	if (x->rate != y->rate)
+		return (x->rate < y->rate) ? -1 : 1;
+
+	return (x->pref < y->pref) ? -1 : (x->pref > y->pref);
+}
+
+static void fl2k_init_pll_table(void)
+{
+	fl2k_pll_setting_t *settings;
+	uint32_t reg, i, n = 0;
+	uint8_t div, mult, frac, out_div = 1;
 
-	/* Output divider (accepts value 1-15) 
-	 * works, but adds lots of phase noise, so do not use it */
-	out_div = 1;
+	settings = malloc(PLL_TABLE_SIZE * sizeof(fl2k_pll_setting_t));
+	if (!settings)
+		return;
 
 	/* Observation: PLL multiplier of 7 works, but has more phase
 	 * noise. Prefer multiplier 6 and 5 */
-	for (mult = 6; mult >= 3; mult--) {
-		for (div = 63; div > 1; div--) {
-			for (frac = 1; frac <= 15; frac++) {
+	for (mult = PLL_MULT_MAX; mult >= PLL_MULT_MIN; mult--) {
+		for (div = PLL_DIV_MAX; div >= PLL_DIV_MIN; div--) {
+			for (frac = 1; frac <= PLL_FRAC_MAX; frac++) {
 				reg =  (mult << 20) | (frac << 16) |
 				       (0x60 << 8) | (out_div << 8) | div;
 
-				sample_clock = fl2k_reg_to_freq(reg);
-				error = sample_clock - (double)target_freq;
-
-				/* Keep closest match */
-				if (fabsf(error) < last_error) {
-					result_reg = reg;
-					last_error = fabsf(error);
-				}
+				settings[n].rate = fl2k_reg_to_freq(reg);
+				settings[n].reg = reg;
+				settings[n].pref = n;
+				n++;
 			}
 		}
 	}
 
-	sample_clock = fl2k_reg_to_freq(result_reg);
+	qsort(settings, n, sizeof(fl2k_pll_setting_t), fl2k_pll_cmp);
+
+	/* keep the preferred setting for every rate */
+	for (i = 0; i < n; i++) {
+		if (pll_num && pll_rates[pll_num - 1] == settings[i].rate)
+			continue;
+
+		pll_rates[pll_num] = settings[i].rate;
+		pll_regs[pll_num] = settings[i].reg;
+		pll_num++;
+	}
+
+	free(settings);
+}
+
+/* index of the achievable rate closest to target */
+static uint32_t fl2k_find_pll_setting(double target)
+{
+	uint32_t lo = 0, hi = pll_num, mid;
+
+	/* first rate >= target */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+
+		if (pll_rates[mid] < target)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == pll_num)
+		return pll_num - 1;
+
+	if (lo && (target - pll_rates[lo - 1]) <= (pll_rates[lo] - target))
+		return lo - 1;
+
+	return lo;
+}
+
+uint32_t fl2k_list_sample_rates(const double **rates)
+{
+	pthread_once(&pll_once, fl2k_init_pll_table);
+
+	if (rates)
+		*rates = pll_rates;
+
+	return pll_num;
+}
+
+int fl2k_set_sample_rate(fl2k_dev_t *dev, uint32_t target_freq)
+{
+	double sample_clock, error;
+	uint32_t i;
+
+	if (!dev)
+		return FL2K_ERROR_INVALID_PARAM;
+
+	pthread_once(&pll_once, fl2k_init_pll_table);
+	if (!pll_num)
+		return FL2K_ERROR_NO_MEM;
+
+	i = fl2k_find_pll_setting((double)target_freq);
+
+	sample_clock = pll_rates[i];
 	error = sample_clock - (double)target_freq;
-	dev->rate = sample_clock;
+	fl2k_store_release(&dev->pll_setting, i + 1);
 
-	if (fabsf(error) > 1)
+	if (fabs(error) > 1)
 		fprintf(stderr, "Requested sample rate %d not possible, using"
 		                " %f, error is %f\n", target_freq, sample_clock, error); 
 
-	return fl2k_write_reg(dev, 0x802c, result_reg);
+	return fl2k_write_reg(dev, 0x802c, pll_regs[i]);
+}
+
+/* sample rate in Hz, 0 if not set yet */
+static double fl2k_rate(fl2k_dev_t *dev)
+{
+	uint32_t setting = fl2k_load_acquire(&dev->pll_setting);
+
+	return setting ? pll_rates[setting - 1] : 0;
 }
 
 uint32_t fl2k_get_sample_rate(fl2k_dev_t *dev)
@@ -274,7 +558,36 @@ uint32_t fl2k_get_sample_rate(fl2k_dev_t *dev)
 	if (!dev)
 		return 0;
 
-	return (uint32_t)dev->rate;
+	return (uint32_t)fl2k_rate(dev);
+}
+
+double fl2k_get_sample_rate_exact(fl2k_dev_t *dev)
+{
+	if (!dev)
+		return 0;
+
+	return fl2k_rate(dev);
+}
+
+int fl2k_set_buffer_len(fl2k_dev_t *dev, uint32_t len)
+{
+	if (!dev || !len || len > FL2K_BUF_LEN || (len % FL2K_BUF_LEN_MIN))
+		return FL2K_ERROR_INVALID_PARAM;
+
+	if (FL2K_INACTIVE != fl2k_load_seq(&dev->async_status))
+		return FL2K_ERROR_BUSY;
+
+	dev->buf_len = len;
+
+	return 0;
+}
+
+uint32_t fl2k_get_buffer_len(fl2k_dev_t *dev)
+{
+	if (!dev)
+		return 0;
+
+	return dev->buf_len;
 }
 
 static fl2k_dongle_t *find_known_device(uint16_t vid, uint16_t pid)
@@ -292,85 +605,345 @@ static fl2k_dongle_t *find_known_device(uint16_t vid, uint16_t pid)
 	return device;
 }
 
-uint32_t fl2k_get_device_count(void)
+/* Process-wide libusb context of the enumeration functions and of all
+ * open devices. It is referenced by the devices, by devices being opened
+ * and by the cache of known devices, which is kept until the library
+ * gets unloaded and is invalidated by hotplug events. Without hotplug
+ * support, the devices are enumerated again on every request. Only the
+ * USB event thread handles its events, it runs the callbacks of devices
+ * serviced by the shared threads and routes the completions of all
+ * other devices to their USB workers. */
+typedef struct fl2k_usb_device {
+	libusb_device *device;
+	fl2k_dongle_t *dongle;
+} fl2k_usb_device_t;
+
+static pthread_mutex_t usb_lock = PTHREAD_MUTEX_INITIALIZER;
+static libusb_context *usb_ctx = NULL;
+static unsigned int usb_ctx_refs = 0;
+static int usb_cache_ref = 0;
+static int usb_hotplug = 0;
+static pthread_t usb_event_thread;
+static uint32_t usb_event_running = 0;
+#if LIBUSB_API_VERSION >= 0x01000102
+static libusb_hotplug_callback_handle usb_hotplug_handle;
+#endif
+
+/* protected by usb_lock, except for usb_devs_valid */
+static fl2k_usb_device_t *usb_devs = NULL;
+static uint32_t usb_dev_cnt = 0;
+static uint32_t usb_devs_valid = 0;
+
+/* Pool of sample workers, servicing the devices opened while enabled
+ * together with the USB event thread. pool_devs is only modified with
+ * pool_lock held, devices are only removed by the event thread. */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_config_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+static int pool_running = 0;
+static int pool_wakeup = 0;
+static uint32_t pool_idle = 0;		/* workers waiting for pool_cond */
+static uint32_t pool_open_devs = 0;	/* open devices using usb_ctx */
+static fl2k_dev_t *pool_devs = NULL;
+static fl2k_dev_t *pool_cursor = NULL;
+static pthread_t *pool_threads = NULL;
+static uint32_t pool_size = 0;
+
+#if LIBUSB_API_VERSION >= 0x01000102
+static int LIBUSB_CALL fl2k_hotplug_cb(libusb_context *ctx,
+				       libusb_device *device,
+				       libusb_hotplug_event event,
+				       void *user_data)
+{
+	struct libusb_device_descriptor dd;
+
+	if (libusb_get_device_descriptor(device, &dd) < 0 ||
+	    find_known_device(dd.idVendor, dd.idProduct))
+		fl2k_store_release(&usb_devs_valid, 0);
+
+	return 0;
+}
+#endif
+
+static void fl2k_usb_free_devices(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < usb_dev_cnt; i++)
+		libusb_unref_device(usb_devs[i].device);
+
+	free(usb_devs);
+	usb_devs = NULL;
+	usb_dev_cnt = 0;
+}
+
+static void *fl2k_usb_event_worker(void *arg);
+
+/* usb_lock has to be held */
+static int fl2k_usb_ref(void)
+{
+	int r;
+
+	if (usb_ctx_refs++)
+		return 0;
+
+	r = libusb_init(&usb_ctx);
+	if (r < 0) {
+		usb_ctx = NULL;
+		usb_ctx_refs = 0;
+		return r;
+	}
+
+#if LIBUSB_API_VERSION >= 0x01000106
+	libusb_set_option(usb_ctx, LIBUSB_OPTION_LOG_LEVEL, 3);
+#else
+	libusb_set_debug(usb_ctx, 3);
+#endif
+
+	fl2k_store_release(&usb_event_running, 1);
+	r = pthread_create(&usb_event_thread, NULL,
+			   fl2k_usb_event_worker, usb_ctx);
+	if (r) {
+		fprintf(stderr, "Error spawning USB event thread!\n");
+		libusb_exit(usb_ctx);
+		usb_ctx = NULL;
+		usb_ctx_refs = 0;
+		return LIBUSB_ERROR_NO_MEM;
+	}
+
+#if LIBUSB_API_VERSION >= 0x01000102
+	if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG) &&
+	    !libusb_hotplug_register_callback(usb_ctx,
+				LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED |
+				LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT,
+				LIBUSB_HOTPLUG_NO_FLAGS,
+				LIBUSB_HOTPLUG_MATCH_ANY,
+				LIBUSB_HOTPLUG_MATCH_ANY,
+				LIBUSB_HOTPLUG_MATCH_ANY,
+				fl2k_hotplug_cb, NULL,
+				&usb_hotplug_handle))
+		usb_hotplug = 1;
+#endif
+
+	return 0;
+}
+
+/* usb_lock has to be held */
+static void fl2k_usb_unref(void)
+{
+	if (--usb_ctx_refs)
+		return;
+
+	fl2k_usb_free_devices();
+	usb_devs_valid = 0;
+
+	/* the thread is only waiting for events at this point, as nothing
+	 * using the context is left */
+	fl2k_store_release(&usb_event_running, 0);
+#if LIBUSB_API_VERSION >= 0x01000105
+	libusb_interrupt_event_handler(usb_ctx);
+#endif
+	pthread_join(usb_event_thread, NULL);
+
+#if LIBUSB_API_VERSION >= 0x01000102
+	if (usb_hotplug)
+		libusb_hotplug_deregister_callback(usb_ctx, usb_hotplug_handle);
+#endif
+	usb_hotplug = 0;
+
+	libusb_exit(usb_ctx);
+	usb_ctx = NULL;
+}
+
+#if defined(__GNUC__)
+__attribute__((destructor))
+static void fl2k_usb_cleanup(void)
+{
+	pthread_mutex_lock(&usb_lock);
+
+	if (usb_cache_ref) {
+		usb_cache_ref = 0;
+		fl2k_usb_unref();
+	}
+
+	pthread_mutex_unlock(&usb_lock);
+}
+#endif
+
+/* Refresh the list of known devices if needed, usb_lock has to be held */
+static int fl2k_usb_update_devices(void)
 {
-	int i,r;
-	libusb_context *ctx;
 	libusb_device **list;
-	uint32_t device_count = 0;
 	struct libusb_device_descriptor dd;
-	ssize_t cnt;
+	fl2k_dongle_t *dongle;
+	ssize_t cnt, i;
+	int r;
 
-	r = libusb_init(&ctx);
-	if (r < 0)
+	if (!usb_cache_ref) {
+		r = fl2k_usb_ref();
+		if (r < 0)
+			return r;
+
+		usb_cache_ref = 1;
+	}
+
+	/* the USB event thread runs the hotplug callback */
+	if (usb_hotplug && fl2k_load_acquire(&usb_devs_valid))
 		return 0;
 
-	cnt = libusb_get_device_list(ctx, &list);
+	/* a device showing up while enumerating invalidates it again */
+	fl2k_store_release(&usb_devs_valid, 1);
+	fl2k_usb_free_devices();
 
-	for (i = 0; i < cnt; i++) {
+	cnt = libusb_get_device_list(usb_ctx, &list);
+	if (cnt < 0) {
+		fl2k_store_release(&usb_devs_valid, 0);
+		return (int)cnt;
+	}
+
+	if (cnt)
+		usb_devs = malloc(cnt * sizeof(fl2k_usb_device_t));
+
+	for (i = 0; usb_devs && i < cnt; i++) {
 		libusb_get_device_descriptor(list[i], &dd);
 
-		if (find_known_device(dd.idVendor, dd.idProduct))
-			device_count++;
+		dongle = find_known_device(dd.idVendor, dd.idProduct);
+		if (!dongle)
+			continue;
+
+		usb_devs[usb_dev_cnt].device = libusb_ref_device(list[i]);
+		usb_devs[usb_dev_cnt].dongle = dongle;
+		usb_dev_cnt++;
 	}
 
 	libusb_free_device_list(list, 1);
 
-	libusb_exit(ctx);
+	return 0;
+}
+
+/* Get a reference to known device number index and to the context */
+static libusb_device *fl2k_usb_get_device(uint32_t index)
+{
+	libusb_device *device = NULL;
+
+	pthread_mutex_lock(&usb_lock);
+
+	if (fl2k_usb_update_devices() >= 0 && index < usb_dev_cnt &&
+	    fl2k_usb_ref() >= 0)
+		device = libusb_ref_device(usb_devs[index].device);
+
+	pthread_mutex_unlock(&usb_lock);
+
+	return device;
+}
+
+static void fl2k_usb_put_device(libusb_device *device)
+{
+	pthread_mutex_lock(&usb_lock);
+	libusb_unref_device(device);
+	fl2k_usb_unref();
+	pthread_mutex_unlock(&usb_lock);
+}
+
+/* The virtual device, if enabled, is listed after the real ones */
+static int fl2k_is_virtual_index(uint32_t index)
+{
+	uint32_t cnt = 0;
+
+	if (!fl2k_virtual_enabled())
+		return 0;
+
+	pthread_mutex_lock(&usb_lock);
+
+	if (fl2k_usb_update_devices() >= 0)
+		cnt = usb_dev_cnt;
+
+	pthread_mutex_unlock(&usb_lock);
+
+	return index == cnt;
+}
+
+uint32_t fl2k_get_device_count(void)
+{
+	uint32_t device_count = 0;
+
+	pthread_mutex_lock(&usb_lock);
+
+	if (fl2k_usb_update_devices() >= 0)
+		device_count = usb_dev_cnt;
+
+	pthread_mutex_unlock(&usb_lock);
+
+	if (fl2k_virtual_enabled())
+		device_count++;
 
 	return device_count;
 }
 
 const char *fl2k_get_device_name(uint32_t index)
 {
-	int i,r;
-	libusb_context *ctx;
-	libusb_device **list;
-	struct libusb_device_descriptor dd;
-	fl2k_dongle_t *device = NULL;
-	uint32_t device_count = 0;
-	ssize_t cnt;
+	const char *name = "";
 
-	r = libusb_init(&ctx);
-	if (r < 0)
-		return "";
+	if (fl2k_is_virtual_index(index))
+		return "Virtual FL2K";
 
-	cnt = libusb_get_device_list(ctx, &list);
+	pthread_mutex_lock(&usb_lock);
 
-	for (i = 0; i < cnt; i++) {
-		libusb_get_device_descriptor(list[i], &dd);
+	if (fl2k_usb_update_devices() >= 0 && index < usb_dev_cnt)
+		name = usb_devs[index].dongle->name;
 
-		device = find_known_device(dd.idVendor, dd.idProduct);
+	pthread_mutex_unlock(&usb_lock);
 
-		if (device) {
-			device_count++;
+	return name;
+}
 
-			if (index == device_count - 1)
-				break;
-		}
+int fl2k_is_device_available(uint32_t index)
+{
+	libusb_device *device;
+	libusb_device_handle *devh;
+	int r;
+
+	if (fl2k_is_virtual_index(index))
+		return FL2K_TRUE;
+
+	device = fl2k_usb_get_device(index);
+	if (!device)
+		return FL2K_ERROR_NOT_FOUND;
+
+	r = libusb_open(device, &devh);
+	if (r >= 0) {
+		/* fails if another process is using the device */
+		r = libusb_claim_interface(devh, 0);
+		if (r >= 0)
+			libusb_release_interface(devh, 0);
+
+		libusb_close(devh);
 	}
 
-	libusb_free_device_list(list, 1);
+	fl2k_usb_put_device(device);
 
-	libusb_exit(ctx);
+	return (r < 0) ? 0 : FL2K_TRUE;
+}
 
-	if (device)
-		return device->name;
-	else
-		return "";
+/* Drop the reference to usb_ctx of a real device after closing it */
+static void fl2k_put_ctx(fl2k_dev_t *dev)
+{
+	if (dev->pooled) {
+		pthread_mutex_lock(&pool_lock);
+		pool_open_devs--;
+		pthread_mutex_unlock(&pool_lock);
+	}
+
+	pthread_mutex_lock(&usb_lock);
+	fl2k_usb_unref();
+	pthread_mutex_unlock(&usb_lock);
 }
 
 int fl2k_open(fl2k_dev_t **out_dev, uint32_t index)
 {
 	int r;
-	int i;
-	libusb_device **list;
 	fl2k_dev_t *dev = NULL;
 	libusb_device *device = NULL;
-	uint32_t device_count = 0;
-	struct libusb_device_descriptor dd;
-	uint8_t reg;
-	ssize_t cnt;
 
 	dev = malloc(sizeof(fl2k_dev_t));
 	if (NULL == dev)
@@ -378,45 +951,47 @@ int fl2k_open(fl2k_dev_t **out_dev, uint32_t index)
 
 	memset(dev, 0, sizeof(fl2k_dev_t));
 
-	r = libusb_init(&dev->ctx);
-	if(r < 0){
-		free(dev);
-		return -1;
-	}
-
-#if LIBUSB_API_VERSION >= 0x01000106
-	libusb_set_option(dev->ctx, LIBUSB_OPTION_LOG_LEVEL, 3);
-#else
-	libusb_set_debug(dev->ctx, 3);
-#endif
+	pthread_mutex_init(&dev->buf_mutex, NULL);
+	pthread_cond_init(&dev->buf_cond, NULL);
+	pthread_mutex_init(&dev->usb_mutex, NULL);
+	pthread_cond_init(&dev->usb_cond, NULL);
 
 	dev->dev_lost = 1;
+	dev->buf_len = FL2K_BUF_LEN;
 
-	cnt = libusb_get_device_list(dev->ctx, &list);
-
-	for (i = 0; i < cnt; i++) {
-		device = list[i];
-
-		libusb_get_device_descriptor(list[i], &dd);
-
-		if (find_known_device(dd.idVendor, dd.idProduct)) {
-			device_count++;
+	if (fl2k_is_virtual_index(index)) {
+		dev->virt = fl2k_virtual_open();
+		if (!dev->virt) {
+			r = FL2K_ERROR_NOT_FOUND;
+			goto err;
 		}
 
-		if (index == device_count - 1)
-			break;
-
-		device = NULL;
+		goto init;
 	}
 
+	device = fl2k_usb_get_device(index);
 	if (!device) {
 		r = -1;
 		goto err;
 	}
 
+	/* serviced by the shared threads if they are enabled */
+	pthread_mutex_lock(&pool_lock);
+	dev->pooled = pool_running;
+	if (dev->pooled)
+		pool_open_devs++;
+	pthread_mutex_unlock(&pool_lock);
+
+	/* the other devices get their completions from the event thread
+	 * handed over to their USB worker */
+	dev->routed = !dev->pooled;
+
+	/* the device reference is only needed for opening it */
+	dev->ctx = usb_ctx;
 	r = libusb_open(device, &dev->devh);
-	libusb_free_device_list(list, 1);
+	libusb_unref_device(device);
 	if (r < 0) {
+		dev->devh = NULL;
 		fprintf(stderr, "usb_open error %d\n", r);
 		if(r == LIBUSB_ERROR_ACCESS)
 			fprintf(stderr, "Please fix the device permissions, e.g. "
@@ -451,6 +1026,7 @@ int fl2k_open(fl2k_dev_t **out_dev, uint32_t index)
 		goto err;
 	}
 
+init:
 	r = fl2k_init_device(dev);
 	if (r < 0)
 		goto err;
@@ -463,9 +1039,18 @@ found:
 	return 0;
 err:
 	if (dev) {
+		if (dev->devh)
+			libusb_close(dev->devh);
+
+		fl2k_virtual_close(dev->virt);
+
 		if (dev->ctx)
-			libusb_exit(dev->ctx);
+			fl2k_put_ctx(dev);
 
+		pthread_mutex_destroy(&dev->buf_mutex);
+		pthread_cond_destroy(&dev->buf_cond);
+		pthread_mutex_destroy(&dev->usb_mutex);
+		pthread_cond_destroy(&dev->usb_cond);
 		free(dev);
 	}
 
@@ -477,122 +1062,692 @@ int fl2k_close(fl2k_dev_t *dev)
 	if (!dev)
 		return FL2K_ERROR_INVALID_PARAM;
 
-	if(!dev->dev_lost) {
+	if (!fl2k_load_acquire(&dev->dev_lost)) {
 		/* block until all async operations have been completed (if any) */
-		while (FL2K_INACTIVE != dev->async_status)
+		while (FL2K_INACTIVE != fl2k_load_seq(&dev->async_status))
 			sleep_ms(100);
 
 		fl2k_deinit_device(dev);
 	}
 
-	libusb_release_interface(dev->devh, 0);
-	libusb_close(dev->devh);
-	libusb_exit(dev->ctx);
+	/* the shared event thread might not be done with the device yet */
+	while (fl2k_load_acquire(&dev->shared))
+		sleep_ms(100);
+
+	if (dev->virt) {
+		fl2k_virtual_close(dev->virt);
+	} else {
+		libusb_release_interface(dev->devh, 0);
+		libusb_close(dev->devh);
+		fl2k_put_ctx(dev);
+	}
 
+	pthread_mutex_destroy(&dev->buf_mutex);
+	pthread_cond_destroy(&dev->buf_cond);
+	pthread_mutex_destroy(&dev->usb_mutex);
+	pthread_cond_destroy(&dev->usb_cond);
 	free(dev);
 
 	return 0;
 }
 
-static struct libusb_transfer *fl2k_get_next_xfer(fl2k_dev_t *dev,
-					          fl2k_buf_state_t state)
+/* monotonic time in nanoseconds */
+static uint64_t fl2k_get_time_ns(void)
 {
-	unsigned int i;
-	int next_buf = -1;
-	uint64_t next_seq = 0;
-	fl2k_xfer_info_t *xfer_info;
+#ifdef _WIN32
+	LARGE_INTEGER freq, cnt;
 
-	for (i = 0; i < dev->xfer_buf_num; i++) {
-		xfer_info = (fl2k_xfer_info_t *)dev->xfer[i]->user_data;
-		if (!xfer_info)
-			continue;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&cnt);
 
-		if (xfer_info->state == state) {
-			if (state == BUF_EMPTY) {
-				return dev->xfer[i];
-			} else if ((xfer_info->seq < next_seq) || next_buf < 0) {
-				next_seq = xfer_info->seq;
-				next_buf = i;
-			}
-		}
-	}
+	return (uint64_t)(cnt.QuadPart / freq.QuadPart) * 1000000000ULL +
+	       (uint64_t)(cnt.QuadPart % freq.QuadPart) * 1000000000ULL /
+	       freq.QuadPart;
+#else
+	struct timespec ts;
 
-	if ((state == BUF_FILLED) && (next_buf >= 0))
-		return dev->xfer[next_buf];
-	else
-		return NULL;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
 }
 
-static void LIBUSB_CALL _libusb_callback(struct libusb_transfer *xfer)
+static int fl2k_ring_init(fl2k_xfer_ring_t *ring, uint32_t num)
 {
-	fl2k_xfer_info_t *xfer_info = (fl2k_xfer_info_t *)xfer->user_data;
-	fl2k_xfer_info_t *next_xfer_info;
-	fl2k_dev_t *dev = (fl2k_dev_t *)xfer_info->dev;
-	struct libusb_transfer *next_xfer = NULL;
-	int r = 0;
+	uint32_t size = 1;
 
-	if (LIBUSB_TRANSFER_COMPLETED == xfer->status) {
-		/* resubmit transfer */
-		if (FL2K_RUNNING == dev->async_status) {
-			/* get next transfer */
-			next_xfer = fl2k_get_next_xfer(dev, BUF_FILLED);
-
-			if (next_xfer) {
-				next_xfer_info = (fl2k_xfer_info_t *) next_xfer->user_data;
-
-				/* Submit next filled transfer */
-				next_xfer_info->state = BUF_SUBMITTED;
-				r = libusb_submit_transfer(next_xfer);
-				xfer_info->state = BUF_EMPTY;
-				pthread_cond_signal(&dev->buf_cond);
-			} else {
-				/* We need to re-submit the transfer
-				 * in any case, as otherwise the device
-				 * stops to output data and hangs
-				 * (happens only in the hacked 'gapless'
-				 * mode without HSYNC and VSYNC)  */
-				r = libusb_submit_transfer(xfer);
-				pthread_cond_signal(&dev->buf_cond);
-				dev->underflow_cnt++;
-			}
-		}
-	}
+	while (size < num)
+		size <<= 1;
 
-	if (((LIBUSB_TRANSFER_CANCELLED != xfer->status) &&
-	     (LIBUSB_TRANSFER_COMPLETED != xfer->status)) ||
-	     (r == LIBUSB_ERROR_NO_DEVICE)) {
-			dev->dev_lost = 1;
-			fl2k_stop_tx(dev);
-			pthread_cond_signal(&dev->buf_cond);
-			fprintf(stderr, "cb transfer status: %d, submit "
-				"transfer %d, canceling...\n", xfer->status, r);
-	}
+	ring->idx = malloc(size * sizeof(uint32_t));
+	if (!ring->idx)
+		return FL2K_ERROR_NO_MEM;
+
+	ring->mask = size - 1;
+	ring->head = 0;
+	ring->tail = 0;
+
+	return 0;
 }
 
-static int fl2k_alloc_submit_transfers(fl2k_dev_t *dev)
+static void fl2k_ring_free(fl2k_xfer_ring_t *ring)
 {
-	unsigned int i;
+	free(ring->idx);
+	ring->idx = NULL;
+}
+
+/* can never overflow, as the rings are large enough for all transfers */
+static void fl2k_ring_push(fl2k_xfer_ring_t *ring, uint32_t idx)
+{
+	uint32_t head = ring->head;
+
+	ring->idx[head & ring->mask] = idx;
+	fl2k_store_release(&ring->head, head + 1);
+}
+
+static int fl2k_ring_pop(fl2k_xfer_ring_t *ring, uint32_t *idx)
+{
+	uint32_t tail = ring->tail;
+
+	if (tail == fl2k_load_acquire(&ring->head))
+		return 0;
+
+	*idx = ring->idx[tail & ring->mask];
+	fl2k_store_release(&ring->tail, tail + 1);
+
+	return 1;
+}
+
+/* Get the next index without removing it, only for the consumer */
+static int fl2k_ring_peek(fl2k_xfer_ring_t *ring, uint32_t *idx)
+{
+	uint32_t tail = ring->tail;
+
+	if (tail == fl2k_load_acquire(&ring->head))
+		return 0;
+
+	*idx = ring->idx[tail & ring->mask];
+
+	return 1;
+}
+
+/* Wake up the sample worker if it is waiting for an empty transfer or
+ * needs to notice that streaming stopped. The caller changed the ring or
+ * the state before, a producer checks them again after announcing that
+ * it is going to wait, so that one of both sides sees the other. Only
+ * then the mutex is needed, which guarantees the wakeup can't get lost
+ * between the producer's check and its pthread_cond_wait(). */
+static void fl2k_notify_sample_worker(fl2k_dev_t *dev)
+{
+	fl2k_fence();
+
+	if (!fl2k_load_acquire(&dev->worker_waiting))
+		return;
+
+	pthread_mutex_lock(&dev->buf_mutex);
+
+	if (dev->worker_waiting && !dev->wakeup_signal_time)
+		dev->wakeup_signal_time = fl2k_get_time_ns();
+
+	pthread_cond_broadcast(&dev->buf_cond);
+	pthread_mutex_unlock(&dev->buf_mutex);
+}
+
+/* Compute the absolute CLOCK_REALTIME deadline for pthread_cond_timedwait() */
+static void fl2k_get_deadline(struct timespec *ts, int timeout_ms)
+{
+#ifdef _WIN32
+	struct _timeb tb;
+
+	_ftime(&tb);
+	ts->tv_sec = tb.time;
+	ts->tv_nsec = tb.millitm * 1000000L;
+#else
+	clock_gettime(CLOCK_REALTIME, ts);
+#endif
+	ts->tv_sec += timeout_ms / 1000;
+	ts->tv_nsec += (timeout_ms % 1000) * 1000000L;
+
+	if (ts->tv_nsec >= 1000000000L) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000L;
+	}
+}
+
+/* Hand back a transfer taken by fl2k_wait_empty_xfer(). Once streaming
+ * stopped, the USB worker waits for the last one before freeing them. */
+static void fl2k_put_acquired(fl2k_dev_t *dev)
+{
+	if (1 != fl2k_fetch_add(&dev->xfer_acquired, -1) ||
+	    FL2K_RUNNING == fl2k_load_seq(&dev->async_status))
+		return;
+
+	pthread_mutex_lock(&dev->buf_mutex);
+	pthread_cond_broadcast(&dev->buf_cond);
+	pthread_mutex_unlock(&dev->buf_mutex);
+}
+
+static int fl2k_stopped_error(fl2k_dev_t *dev)
+{
+	return fl2k_load_acquire(&dev->dev_lost) ? FL2K_ERROR_NO_DEVICE :
+						   FL2K_ERROR_BUSY;
+}
+
+/* Take an empty transfer out of the ring, for the sample worker or an
+ * application thread using fl2k_acquire_tx_buffer(). A negative timeout
+ * waits forever, 0 doesn't wait at all. The transfer is counted as
+ * acquired before checking the state, so that the USB worker can't free
+ * the transfers under our feet once streaming stopped. Only waiting for
+ * a transfer takes the mutex. Returns 0 with the transfer in idx,
+ * FL2K_ERROR_TIMEOUT, or FL2K_ERROR_BUSY (FL2K_ERROR_NO_DEVICE if the
+ * device is gone) once streaming stopped. */
+static int fl2k_wait_empty_xfer(fl2k_dev_t *dev, uint32_t *idx, int timeout_ms)
+{
+	struct timespec deadline;
+	uint64_t lat;
+	int r = 0;
+
+	fl2k_fetch_add(&dev->xfer_acquired, 1);
+
+	if (FL2K_RUNNING == fl2k_load_seq(&dev->async_status) &&
+	    fl2k_ring_pop(&dev->empty, idx))
+		return 0;
+
+	if (timeout_ms > 0)
+		fl2k_get_deadline(&deadline, timeout_ms);
+
+	pthread_mutex_lock(&dev->buf_mutex);
+	fl2k_fetch_add(&dev->worker_waiting, 1);
+	dev->wakeup_signal_time = 0;
+
+	/* pairs with fl2k_notify_sample_worker() */
+	fl2k_fence();
+
+	while (1) {
+		if (FL2K_RUNNING != fl2k_load_seq(&dev->async_status)) {
+			r = fl2k_stopped_error(dev);
+			break;
+		}
+
+		if (fl2k_ring_pop(&dev->empty, idx))
+			break;
+
+		if (!timeout_ms) {
+			r = FL2K_ERROR_TIMEOUT;
+			break;
+		}
+
+		if (timeout_ms < 0) {
+			pthread_cond_wait(&dev->buf_cond, &dev->buf_mutex);
+		} else if (pthread_cond_timedwait(&dev->buf_cond,
+						  &dev->buf_mutex,
+						  &deadline) == ETIMEDOUT) {
+			/* the transfer might have arrived just in time */
+			if (FL2K_RUNNING == fl2k_load_seq(&dev->async_status) &&
+			    fl2k_ring_pop(&dev->empty, idx))
+				break;
+
+			r = FL2K_ERROR_TIMEOUT;
+			break;
+		}
+	}
+
+	/* time from the USB completion until we are running again */
+	if (!r && dev->wakeup_signal_time) {
+		lat = fl2k_get_time_ns() - dev->wakeup_signal_time;
+
+		dev->wakeup_cnt++;
+		dev->wakeup_lat_sum += lat;
+		if (lat > dev->wakeup_lat_max)
+			dev->wakeup_lat_max = lat;
+
+		dev->wakeup_signal_time = 0;
+	}
+
+	fl2k_fetch_add(&dev->worker_waiting, -1);
+	pthread_mutex_unlock(&dev->buf_mutex);
+
+	if (r < 0)
+		fl2k_put_acquired(dev);
+
+	return r;
+}
+
+/* Hand a transfer filled with samples over to the USB worker. Once
+ * streaming stopped it is only returned, so the USB worker can free the
+ * transfers when the last one is back. */
+static int fl2k_put_filled_xfer(fl2k_dev_t *dev, uint32_t idx)
+{
+	int r = 0;
+
+	if (FL2K_RUNNING == fl2k_load_seq(&dev->async_status))
+		fl2k_ring_push(&dev->filled, idx);
+	else
+		r = fl2k_stopped_error(dev);
+
+	fl2k_put_acquired(dev);
+
+	return r;
+}
+
+/* Wake up an idle pool worker, a worker checks the rings again after
+ * announcing that it is going to wait, like the sample worker does */
+static void fl2k_wake_pool(void)
+{
+	fl2k_fence();
+
+	if (!fl2k_load_acquire(&pool_idle))
+		return;
+
+	pthread_mutex_lock(&pool_lock);
+	pthread_cond_signal(&pool_cond);
+	pthread_mutex_unlock(&pool_lock);
+}
+
+/* Submit transfer idx, keeping track of the transfers in flight and
+ * the sample it starts at, as the transfers are sent back to back. The
+ * counters are atomic, as the application submits the first transfers
+ * while the shared event thread may already handle completions. */
+static int fl2k_submit_xfer(fl2k_dev_t *dev, uint32_t idx)
+{
+	uint32_t len = dev->xfer_buf_len / 3;
+	int r;
+
+	fl2k_fetch_add(&dev->xfer_in_flight, 1);
+	dev->xfer_info[idx].tick = fl2k_fetch_add64(&dev->submit_tick, len);
+
+	dev->xfer_info[idx].submit_time = fl2k_get_time_ns();
+	if (dev->virt)
+		r = fl2k_virtual_submit(dev->virt, dev->xfer[idx], len,
+					fl2k_rate(dev));
+	else
+		r = libusb_submit_transfer(dev->xfer[idx]);
+
+	if (r < 0) {
+		fl2k_fetch_add(&dev->xfer_in_flight, -1);
+		fl2k_fetch_add64(&dev->submit_tick, -(uint64_t)len);
+	} else {
+		fl2k_store_release(&dev->last_submitted, idx);
+	}
+
+	return r;
+}
+
+/* Account for a transfer handed back by libusb, only called by the
+ * thread handling the events of the device */
+static void fl2k_count_xfer(fl2k_dev_t *dev, fl2k_xfer_info_t *xfer_info,
+			    int completed)
+{
+	uint64_t now = fl2k_get_time_ns();
+	uint64_t lat = now - xfer_info->submit_time;
+
+	fl2k_fetch_add(&dev->xfer_in_flight, -1);
+
+	if (!completed)
+		return;
+
+	if (!dev->xfer_done)
+		fl2k_store_release64(&dev->first_done_time, now);
+	fl2k_store_release64(&dev->xfer_done_time, now);
+
+	fl2k_store_release64(&dev->usb_lat_sum, dev->usb_lat_sum + lat);
+	if (lat > dev->usb_lat_max)
+		fl2k_store_release64(&dev->usb_lat_max, lat);
+
+	/* published last, for the readers of the times above */
+	fl2k_store_release64(&dev->xfer_done, dev->xfer_done + 1);
+
+	/* only report transfers with samples of the application */
+	if (xfer_info->idx < dev->xfer_buf_num && dev->tx_done_hook)
+		dev->tx_done_hook(dev->tx_done_ctx, xfer_info->tick,
+				  xfer_info->target_tick, xfer_info->timed);
+}
+
+/* The adaptive depth shrinks by one transfer after this long without
+ * an underflow */
+#define ADAPT_STABLE_MS		2000
+
+/* Check if a completed transfer should be parked instead of being
+ * replaced, as more transfers than the adaptive depth are in flight */
+static int fl2k_adapt_shrink(fl2k_dev_t *dev)
+{
+	uint64_t now;
+
+	if (dev->xfer_depth_max <= dev->xfer_num)
+		return 0;
+
+	now = fl2k_get_time_ns();
+
+	if (dev->xfer_depth > dev->xfer_num &&
+	    now - dev->depth_change_time > ADAPT_STABLE_MS * 1000000ULL) {
+		fl2k_store_release(&dev->xfer_depth, dev->xfer_depth - 1);
+		dev->depth_change_time = now;
+	}
+
+	return fl2k_load_acquire(&dev->xfer_in_flight) >= dev->xfer_depth;
+}
+
+/* Increase the adaptive depth after an underflow, the sample worker gets
+ * a parked transfer to fill ahead, which is submitted on top of the
+ * others once it is filled */
+static void fl2k_adapt_grow(fl2k_dev_t *dev)
+{
+	uint32_t idx;
+	int grown = 0;
+
+	if (dev->xfer_depth_max <= dev->xfer_num)
+		return;
+
+	dev->depth_change_time = fl2k_get_time_ns();
+
+	if (dev->xfer_depth < dev->xfer_depth_max &&
+	    fl2k_ring_pop(&dev->spare, &idx)) {
+		fl2k_store_release(&dev->xfer_depth, dev->xfer_depth + 1);
+		fl2k_ring_push(&dev->empty, idx);
+		grown = 1;
+	}
+
+	if (grown) {
+		fl2k_notify_sample_worker(dev);
+
+		if (dev->cb && fl2k_load_acquire(&dev->shared))
+			fl2k_wake_pool();
+	}
+}
+
+static int fl2k_below_depth(fl2k_dev_t *dev)
+{
+	return fl2k_load_acquire(&dev->xfer_in_flight) < dev->xfer_depth;
+}
+
+/* Pop the next filled transfer, unless it is scheduled for a later
+ * sample than the next submission would start at */
+static int fl2k_pop_due(fl2k_dev_t *dev, uint32_t *idx)
+{
+	uint32_t next;
+
+	if (!fl2k_ring_peek(&dev->filled, &next))
+		return 0;
+
+	/* the target was written before the transfer was queued */
+	if (dev->xfer_info[next].target_tick >
+	    fl2k_load_acquire64(&dev->submit_tick))
+		return 0;
+
+	return fl2k_ring_pop(&dev->filled, idx);
+}
+
+/* Hand a transfer that is not needed anymore back to ring, or to the
+ * other fill transfers if it is one of them */
+static void fl2k_release_xfer(fl2k_dev_t *dev, uint32_t idx,
+			      fl2k_xfer_ring_t *ring)
+{
+	if (idx >= dev->xfer_buf_num)
+		fl2k_ring_push(&dev->fill, idx);
+	else
+		fl2k_ring_push(ring, idx);
+}
+
+/* Let the fill buffer hold the last sample of each DAC that was
+ * submitted. If they changed, the other buffer is rewritten and used
+ * from now on, unless it is still being sent. */
+static void fl2k_update_hold(fl2k_dev_t *dev)
+{
+	unsigned char block[FL2K_BLOCK_LEN];
+	const unsigned char *last;
+	unsigned char *buf;
+	uint32_t c, s, len, n, submitted, next;
+
+	submitted = fl2k_load_acquire(&dev->last_submitted);
+
+	/* a fill transfer already holds the samples */
+	if (submitted >= dev->xfer_buf_num)
+		return;
+
+	last = dev->xfer_buf[submitted] + dev->xfer_buf_len -
+	       FL2K_BLOCK_LEN;
+
+	for (c = 0; c < 3; c++) {
+		for (s = 0; s < FL2K_BLOCK_SAMPLES; s++)
+			block[fl2k_get_raw_offset(c, s)] =
+			    last[fl2k_get_raw_offset(c, FL2K_BLOCK_SAMPLES - 1)];
+	}
+
+	if (!memcmp(dev->fill_buf[dev->fill_cur], block, FL2K_BLOCK_LEN))
+		return;
+
+	/* better hold the previous samples than change them on the fly */
+	next = dev->fill_cur ^ 1;
+	if (dev->fill_busy[next])
+		return;
+
+	buf = dev->fill_buf[next];
+	memcpy(buf, block, FL2K_BLOCK_LEN);
+
+	for (len = FL2K_BLOCK_LEN; len < dev->xfer_buf_len; len += n) {
+		n = dev->xfer_buf_len - len;
+		if (n > len)
+			n = len;
+
+		memcpy(buf + len, buf, n);
+	}
+
+	dev->fill_cur = next;
+}
+
+/* Submit fill transfer idx, sending the current fill buffer */
+static int fl2k_submit_fill_xfer(fl2k_dev_t *dev, uint32_t idx)
+{
+	uint32_t buf = dev->fill_cur;
+	int r;
+
+	dev->xfer[idx]->buffer = dev->fill_buf[buf];
+	dev->fill_busy[buf]++;
+
+	r = fl2k_submit_xfer(dev, idx);
+	if (r < 0)
+		dev->fill_busy[buf]--;
+
+	return r;
+}
+
+/* Submit a fill transfer after transfer idx completed, silence or the
+ * held samples */
+static int fl2k_submit_fill(fl2k_dev_t *dev, uint32_t idx)
+{
+	uint32_t fill = idx;
+
+	/* fill transfers just keep going, there are as many of them as
+	 * can be in flight */
+	if (idx < dev->xfer_buf_num && !fl2k_ring_pop(&dev->fill, &fill))
+		return fl2k_submit_xfer(dev, idx);
+
+	/* idx may be the last data transfer submitted, so this has to
+	 * happen before it is handed out again */
+	if (FL2K_UNDERFLOW_HOLD == dev->underflow_policy)
+		fl2k_update_hold(dev);
+
+	if (fill != idx) {
+		/* the data transfer can be filled again meanwhile */
+		fl2k_ring_push(&dev->empty, idx);
+		fl2k_notify_sample_worker(dev);
+
+		if (dev->cb && fl2k_load_acquire(&dev->shared))
+			fl2k_wake_pool();
+	}
+
+	return fl2k_submit_fill_xfer(dev, fill);
+}
+
+/* Submit a transfer when no filled one is ready, according to the
+ * underflow policy. We need to submit one in any case, as otherwise the
+ * device stops to output data and hangs (happens only in the hacked
+ * 'gapless' mode without HSYNC and VSYNC). */
+static int fl2k_submit_underflow(fl2k_dev_t *dev, uint32_t idx)
+{
+	if (FL2K_UNDERFLOW_REPEAT == dev->underflow_policy)
+		return fl2k_submit_xfer(dev, idx);
+
+	return fl2k_submit_fill(dev, idx);
+}
+
+/* Wake up the USB worker of a routed device waiting in
+ * fl2k_handle_done(), like fl2k_notify_sample_worker() does */
+static void fl2k_wake_usb_worker(fl2k_dev_t *dev)
+{
+	fl2k_fence();
+
+	if (!fl2k_load_acquire(&dev->usb_waiting))
+		return;
+
+	pthread_mutex_lock(&dev->usb_mutex);
+	pthread_cond_signal(&dev->usb_cond);
+	pthread_mutex_unlock(&dev->usb_mutex);
+}
+
+/* Handle a transfer handed back by libusb, called by the thread
+ * servicing the device */
+static void fl2k_xfer_done(struct libusb_transfer *xfer)
+{
+	fl2k_xfer_info_t *xfer_info = (fl2k_xfer_info_t *)xfer->user_data;
+	fl2k_dev_t *dev = (fl2k_dev_t *)xfer_info->dev;
+	/* the transfer may complete again once it is resubmitted */
+	int status = xfer->status;
+	uint32_t next;
 	int r = 0;
 
+	/* the fill buffer it was sending may be rewritten again */
+	if (xfer_info->idx >= dev->xfer_buf_num)
+		dev->fill_busy[xfer->buffer == dev->fill_buf[1]]--;
+
+	fl2k_count_xfer(dev, xfer_info,
+			LIBUSB_TRANSFER_COMPLETED == status);
+
+	if (LIBUSB_TRANSFER_COMPLETED == status) {
+		/* resubmit transfer */
+		if (FL2K_RUNNING == fl2k_load_seq(&dev->async_status)) {
+			/* In loop mode, every transfer is queued again
+			 * right away, the order of the loop is kept as
+			 * the transfer count is a multiple of its length */
+			if (dev->loop_xfers) {
+				r = fl2k_submit_xfer(dev, xfer_info->idx);
+			/* Leave the transfer out when shrinking the depth,
+			 * the others are still in flight */
+			} else if (fl2k_adapt_shrink(dev)) {
+				fl2k_release_xfer(dev, xfer_info->idx,
+						  &dev->spare);
+			/* Submit next filled transfer, if any */
+			} else if (fl2k_pop_due(dev, &next)) {
+				r = fl2k_submit_xfer(dev, next);
+				fl2k_release_xfer(dev, xfer_info->idx,
+						  &dev->empty);
+
+				/* catch up with a grown depth */
+				while (!r && fl2k_below_depth(dev) &&
+				       fl2k_pop_due(dev, &next))
+					r = fl2k_submit_xfer(dev, next);
+
+				fl2k_notify_sample_worker(dev);
+
+				if (dev->cb && fl2k_load_acquire(&dev->shared))
+					fl2k_wake_pool();
+			/* Wait for the time of the next filled transfer */
+			} else if (fl2k_ring_peek(&dev->filled, &next)) {
+				r = fl2k_submit_fill(dev, xfer_info->idx);
+			} else {
+				r = fl2k_submit_underflow(dev, xfer_info->idx);
+				fl2k_store_release(&dev->underflow_cnt,
+						   dev->underflow_cnt + 1);
+				fl2k_adapt_grow(dev);
+			}
+		}
+	}
+
+	if (((LIBUSB_TRANSFER_CANCELLED != status) &&
+	     (LIBUSB_TRANSFER_COMPLETED != status)) ||
+	     (r == LIBUSB_ERROR_NO_DEVICE)) {
+			fl2k_store_release(&dev->dev_lost, 1);
+			fl2k_stop_tx(dev);
+			fl2k_notify_sample_worker(dev);
+			fprintf(stderr, "cb transfer status: %d, submit "
+				"transfer %d, canceling...\n", status, r);
+	}
+}
+
+static void LIBUSB_CALL _libusb_callback(struct libusb_transfer *xfer)
+{
+	fl2k_xfer_info_t *xfer_info = (fl2k_xfer_info_t *)xfer->user_data;
+	fl2k_dev_t *dev = (fl2k_dev_t *)xfer_info->dev;
+
+	/* called by the USB event thread, the USB worker of the device
+	 * takes it from here */
+	if (dev->routed) {
+		fl2k_fetch_add(&dev->routing, 1);
+		fl2k_ring_push(&dev->done, xfer_info->idx);
+		fl2k_wake_usb_worker(dev);
+		fl2k_fetch_add(&dev->routing, -1);
+		return;
+	}
+
+	fl2k_xfer_done(xfer);
+}
+
+static int fl2k_alloc_transfers(fl2k_dev_t *dev)
+{
+	unsigned int i;
+	uint32_t xfer_total;
+
 	if (!dev)
 		return FL2K_ERROR_INVALID_PARAM;
 
-	dev->xfer = malloc(dev->xfer_buf_num * sizeof(struct libusb_transfer *));
+	xfer_total = dev->xfer_buf_num + dev->fill_xfer_num;
 
-	for (i = 0; i < dev->xfer_buf_num; ++i)
+	dev->xfer = malloc(xfer_total * sizeof(struct libusb_transfer *));
+
+	for (i = 0; i < xfer_total; ++i)
 		dev->xfer[i] = libusb_alloc_transfer(0);
 
 	dev->xfer_buf = malloc(dev->xfer_buf_num * sizeof(unsigned char *));
 	memset(dev->xfer_buf, 0, dev->xfer_buf_num * sizeof(unsigned char *));
 
-	dev->xfer_info = malloc(dev->xfer_buf_num * sizeof(fl2k_xfer_info_t));
-	memset(dev->xfer_info, 0, dev->xfer_buf_num * sizeof(fl2k_xfer_info_t));
+	dev->xfer_info = malloc(xfer_total * sizeof(fl2k_xfer_info_t));
+	memset(dev->xfer_info, 0, xfer_total * sizeof(fl2k_xfer_info_t));
+
+	if (fl2k_ring_init(&dev->filled, dev->xfer_buf_num) < 0 ||
+	    fl2k_ring_init(&dev->empty, dev->xfer_buf_num) < 0 ||
+	    fl2k_ring_init(&dev->spare, dev->xfer_buf_num) < 0 ||
+	    fl2k_ring_init(&dev->fill, dev->fill_xfer_num) < 0 ||
+	    fl2k_ring_init(&dev->done, xfer_total) < 0)
+		return FL2K_ERROR_NO_MEM;
+
+	dev->cancel_sent = 0;
+
+	dev->fill_cur = 0;
+	dev->fill_busy[0] = 0;
+	dev->fill_busy[1] = 0;
+
+	if (dev->fill_xfer_num) {
+		dev->fill_buf[0] = calloc(1, dev->xfer_buf_len);
+		if (!dev->fill_buf[0])
+			return FL2K_ERROR_NO_MEM;
+	}
+
+	if (dev->fill_xfer_num &&
+	    FL2K_UNDERFLOW_HOLD == dev->underflow_policy) {
+		dev->fill_buf[1] = calloc(1, dev->xfer_buf_len);
+		if (!dev->fill_buf[1])
+			return FL2K_ERROR_NO_MEM;
+	}
 
 #if defined (__linux__) && LIBUSB_API_VERSION >= 0x01000105
-	fprintf(stderr, "Allocating %d zero-copy buffers\n", dev->xfer_buf_num);
+	/* the virtual device doesn't send from kernel buffers */
+	if (!dev->virt) {
+		fprintf(stderr, "Allocating %d zero-copy buffers\n",
+			dev->xfer_buf_num);
+		dev->use_zerocopy = 1;
+	}
 
-	dev->use_zerocopy = 1;
-	for (i = 0; i < dev->xfer_buf_num; ++i) {
+	for (i = 0; dev->use_zerocopy && i < dev->xfer_buf_num; ++i) {
 		dev->xfer_buf[i] = libusb_dev_mem_alloc(dev->devh, dev->xfer_buf_len);
 
 		if (dev->xfer_buf[i]) {
@@ -654,356 +1809,1473 @@ static int fl2k_alloc_submit_transfers(fl2k_dev_t *dev)
 					  0);
 
 		dev->xfer_info[i].dev = dev;
-		dev->xfer_info[i].state = BUF_EMPTY;
+		dev->xfer_info[i].idx = i;
+
+		if (dev->loop_xfers) {
+			memcpy(dev->xfer_buf[i], dev->loop_buf +
+			       (i % dev->loop_xfers) * dev->xfer_buf_len,
+			       dev->xfer_buf_len);
+		/* if we allocate the memory through the Kernel, it is
+		 * already cleared */
+		} else if (!dev->use_zerocopy) {
+			memset(dev->xfer_buf[i], 0, dev->xfer_buf_len);
+		}
+	}
+
+	/* the fill transfers share the fill buffers, which are only read
+	 * while sending */
+	for (; i < xfer_total; ++i) {
+		libusb_fill_bulk_transfer(dev->xfer[i],
+					  dev->devh,
+					  0x01,
+					  dev->fill_buf[0],
+					  dev->xfer_buf_len,
+					  _libusb_callback,
+					  &dev->xfer_info[i],
+					  0);
+
+		dev->xfer_info[i].dev = dev;
+		dev->xfer_info[i].idx = i;
+		fl2k_ring_push(&dev->fill, i);
+	}
+
+	return 0;
+}
+
+/* Queue the transfers that are not submitted initially, to be filled
+ * by the sample worker. Two of them are kept as spare ones to fill
+ * ahead, the ones allocated for growing the adaptive depth are parked. */
+static void fl2k_queue_unsubmitted(fl2k_dev_t *dev)
+{
+	uint32_t i;
+
+	for (i = dev->xfer_num; i < dev->xfer_buf_num; ++i) {
+		if (i < dev->xfer_num + 2)
+			fl2k_ring_push(&dev->empty, i);
+		else
+			fl2k_ring_push(&dev->spare, i);
+	}
+}
+
+static int fl2k_submit_transfers(fl2k_dev_t *dev)
+{
+	unsigned int i;
+	int r = 0;
+
+	/* the remaining transfers can be filled by the sample worker, this
+	 * has to happen first, as the transfers of a device serviced by
+	 * the shared threads complete on the USB event thread right away */
+	fl2k_queue_unsubmitted(dev);
+
+	for (i = 0; i < dev->xfer_num; ++i) {
+		r = fl2k_submit_xfer(dev, i);
+
+		if (r < 0) {
+			fprintf(stderr, "Failed to submit transfer %i\n"
+					"Please increase your allowed " 
+					"usbfs buffer size with the "
+					"following command:\n"
+					"echo 0 > /sys/module/usbcore"
+					"/parameters/usbfs_memory_mb\n", i);
+			break;
+		}
+	}
+
+	/* the ones that could not be submitted are left out */
+	return r;
+}
+
+static int _fl2k_free_async_buffers(fl2k_dev_t *dev)
+{
+	unsigned int i;
+
+	if (!dev)
+		return FL2K_ERROR_INVALID_PARAM;
+
+	if (dev->xfer) {
+		for (i = 0; i < dev->xfer_buf_num + dev->fill_xfer_num; ++i) {
+			if (dev->xfer[i]) {
+				libusb_free_transfer(dev->xfer[i]);
+			}
+		}
+
+		free(dev->xfer);
+		dev->xfer = NULL;
+	}
+
+	if (dev->xfer_buf) {
+		for (i = 0; i < dev->xfer_buf_num; ++i) {
+			if (dev->xfer_buf[i]) {
+				if (dev->use_zerocopy) {
+#if defined (__linux__) && LIBUSB_API_VERSION >= 0x01000105
+					libusb_dev_mem_free(dev->devh,
+							    dev->xfer_buf[i],
+							    dev->xfer_buf_len);
+#endif
+				} else {
+					free(dev->xfer_buf[i]);
+				}
+			}
+		}
+
+		free(dev->xfer_buf);
+		dev->xfer_buf = NULL;
+	}
+
+	free(dev->xfer_info);
+	dev->xfer_info = NULL;
+
+	free(dev->fill_buf[0]);
+	free(dev->fill_buf[1]);
+	dev->fill_buf[0] = NULL;
+	dev->fill_buf[1] = NULL;
+
+	fl2k_ring_free(&dev->filled);
+	fl2k_ring_free(&dev->empty);
+	fl2k_ring_free(&dev->spare);
+	fl2k_ring_free(&dev->fill);
+	fl2k_ring_free(&dev->done);
+
+	return 0;
+}
+
+/* Handle the transfers the USB event thread handed over to the USB
+ * worker of a routed device, waiting up to tv for them unless completed
+ * gets set */
+static int fl2k_handle_done(fl2k_dev_t *dev, struct timeval *tv,
+			    int *completed)
+{
+	struct timespec deadline;
+	uint32_t idx;
+	int handled = 0;
+
+	while (fl2k_ring_pop(&dev->done, &idx)) {
+		fl2k_xfer_done(dev->xfer[idx]);
+		handled = 1;
+	}
+
+	if (handled || (!tv->tv_sec && !tv->tv_usec))
+		return 0;
+
+	fl2k_get_deadline(&deadline, tv->tv_sec * 1000 + tv->tv_usec / 1000);
+
+	pthread_mutex_lock(&dev->usb_mutex);
+	fl2k_fetch_add(&dev->usb_waiting, 1);
+
+	/* pairs with fl2k_wake_usb_worker() */
+	fl2k_fence();
+
+	if (!fl2k_ring_peek(&dev->done, &idx) &&
+	    !(completed && fl2k_load_acquire((uint32_t *)completed)))
+		pthread_cond_timedwait(&dev->usb_cond, &dev->usb_mutex,
+				       &deadline);
+
+	fl2k_fetch_add(&dev->usb_waiting, -1);
+	pthread_mutex_unlock(&dev->usb_mutex);
+
+	while (fl2k_ring_pop(&dev->done, &idx))
+		fl2k_xfer_done(dev->xfer[idx]);
+
+	return 0;
+}
+
+/* Handle the USB events of a device, only called by the thread
+ * servicing it, which is the USB event thread for pooled devices */
+static int fl2k_handle_events(fl2k_dev_t *dev, struct timeval *tv,
+			      int *completed)
+{
+	if (dev->virt)
+		return fl2k_virtual_handle_events(dev->virt, tv, completed);
+
+	if (dev->routed)
+		return fl2k_handle_done(dev, tv, completed);
+
+	return libusb_handle_events_timeout_completed(dev->ctx, tv, completed);
+}
+
+/* Cancel all pending transfers of a device that stops streaming.
+ * Returns 1 once there is nothing left to wait for, next_status is the
+ * state the device enters after its buffers have been freed. */
+static int fl2k_cancel_xfers(fl2k_dev_t *dev,
+			     enum fl2k_async_status *next_status)
+{
+	struct timeval zerotv = { 0, 0 };
+	unsigned int i;
+	int r;
+
+	*next_status = FL2K_INACTIVE;
+
+	if (!dev->xfer)
+		return 1;
+
+	/* The USB event thread may still be about to hand over a transfer,
+	 * so wait until every submitted one came back. None is submitted
+	 * again once streaming stopped. */
+	if (dev->routed) {
+		for (i = 0; !dev->cancel_sent &&
+			    i < dev->xfer_buf_num + dev->fill_xfer_num; ++i) {
+			if (dev->xfer[i])
+				libusb_cancel_transfer(dev->xfer[i]);
+		}
+
+		dev->cancel_sent = 1;
+		fl2k_handle_done(dev, &zerotv, NULL);
+
+		if (fl2k_load_acquire(&dev->xfer_in_flight)) {
+			*next_status = FL2K_CANCELING;
+			return 0;
+		}
+
+		/* the event thread may still be waking us up */
+		while (fl2k_load_seq(&dev->routing))
+			sleep_ms(1);
+
+		return 1;
+	}
+
+	for (i = 0; i < dev->xfer_buf_num + dev->fill_xfer_num; ++i) {
+		if (!dev->xfer[i])
+			continue;
+
+		if (LIBUSB_TRANSFER_CANCELLED != dev->xfer[i]->status) {
+			if (dev->virt)
+				r = fl2k_virtual_cancel(dev->virt,
+							dev->xfer[i]);
+			else
+				r = libusb_cancel_transfer(dev->xfer[i]);
+			/* handle events after canceling
+			 * to allow transfer status to
+			 * propagate */
+			fl2k_handle_events(dev, &zerotv, NULL);
+			if (r < 0)
+				continue;
+
+			*next_status = FL2K_CANCELING;
+		}
+	}
+
+	if (fl2k_load_acquire(&dev->dev_lost) ||
+	    FL2K_INACTIVE == *next_status) {
+		/* handle any events that still need to
+		 * be handled before exiting after we
+		 * just cancelled all transfers */
+		fl2k_handle_events(dev, &zerotv, NULL);
+		return 1;
+	}
+
+	return 0;
+}
+
+static const char *fl2k_thread_names[FL2K_THREAD_NUM] = {
+	"USB worker",
+	"sample worker",
+};
+
+/* Apply the scheduling settings cfg to a thread, tid is the kernel thread
+ * id needed for setting the nice level on Linux */
+static int fl2k_sched_thread(const fl2k_thread_cfg_t *cfg, pthread_t thread,
+			     long tid)
+{
+	struct sched_param param;
+	int policy = SCHED_OTHER;
+	int r;
+
+	memset(&param, 0, sizeof(param));
+
+	if (FL2K_SCHED_FIFO == cfg->policy)
+		policy = SCHED_FIFO;
+	else if (FL2K_SCHED_RR == cfg->policy)
+		policy = SCHED_RR;
+
+	if (SCHED_OTHER != policy)
+		param.sched_priority = cfg->priority;
+
+	r = pthread_setschedparam(thread, policy, &param);
+	if (r)
+		return (EPERM == r) ? FL2K_ERROR_ACCESS : FL2K_ERROR_INVALID_PARAM;
+
+#ifdef __linux__
+	{
+		cpu_set_t set;
+		unsigned int i;
+
+		CPU_ZERO(&set);
+		for (i = 0; i < CPU_SETSIZE; i++) {
+			if (!cfg->cpu_mask || (i < 64 && (cfg->cpu_mask >> i) & 1))
+				CPU_SET(i, &set);
+		}
+
+		if (pthread_setaffinity_np(thread, sizeof(set), &set))
+			return FL2K_ERROR_INVALID_PARAM;
+	}
+
+	/* the nice level only matters for SCHED_OTHER, and setting it
+	 * back to 0 would need the privileges for lowering it */
+	if (FL2K_SCHED_OTHER == cfg->policy && cfg->nice &&
+	    setpriority(PRIO_PROCESS, (id_t)tid, cfg->nice) < 0)
+		return (EACCES == errno || EPERM == errno) ?
+		       FL2K_ERROR_ACCESS : FL2K_ERROR_INVALID_PARAM;
+#else
+	(void)tid;
+#endif
+
+	return 0;
+}
+
+/* Called by a library thread when it starts running for dev */
+static void fl2k_thread_enter(fl2k_dev_t *dev, int thread)
+{
+	int r = 0;
+
+	pthread_mutex_lock(&dev->buf_mutex);
+	dev->thread_self[thread] = pthread_self();
+#ifdef __linux__
+	dev->thread_tid[thread] = syscall(SYS_gettid);
+#endif
+	dev->thread_running[thread] = 1;
+
+	if (dev->thread_cfg[thread].set)
+		r = fl2k_sched_thread(&dev->thread_cfg[thread],
+				      dev->thread_self[thread],
+				      dev->thread_tid[thread]);
+	pthread_mutex_unlock(&dev->buf_mutex);
+
+	if (FL2K_ERROR_ACCESS == r)
+		fprintf(stderr, "Insufficient privileges for changing the "
+			"scheduling of the %s thread, this needs CAP_SYS_NICE "
+			"or a sufficient RLIMIT_RTPRIO/RLIMIT_NICE\n",
+			fl2k_thread_names[thread]);
+	else if (r < 0)
+		fprintf(stderr, "Failed to change the scheduling of the %s "
+			"thread\n", fl2k_thread_names[thread]);
+}
+
+static void fl2k_thread_leave(fl2k_dev_t *dev, int thread)
+{
+	pthread_mutex_lock(&dev->buf_mutex);
+	dev->thread_running[thread] = 0;
+	pthread_mutex_unlock(&dev->buf_mutex);
+}
+
+static void *fl2k_usb_worker(void *arg)
+{
+	fl2k_dev_t *dev = (fl2k_dev_t *)arg;
+	struct timeval tv = { 1, 0 };
+	enum fl2k_async_status next_status = FL2K_INACTIVE;
+	int r = 0;
+
+	fl2k_thread_enter(dev, FL2K_THREAD_USB);
+
+	while (FL2K_RUNNING == fl2k_load_seq(&dev->async_status)) {
+		r = fl2k_handle_events(dev, &tv, &dev->async_cancel);
+	}
+
+	while (FL2K_INACTIVE != fl2k_load_seq(&dev->async_status)) {
+		r = fl2k_handle_events(dev, &tv, &dev->async_cancel);
+		if (r < 0) {
+			/*fprintf(stderr, "handle_events returned: %d\n", r);*/
+			if (r == LIBUSB_ERROR_INTERRUPTED) /* stray signal */
+				continue;
+			break;
+		}
+
+		if (FL2K_CANCELING == fl2k_load_seq(&dev->async_status) &&
+		    fl2k_cancel_xfers(dev, &next_status))
+			break;
+	}
+
+	/* wait for sample worker thread to finish and for all transfers
+	 * to be handed back by the application before freeing buffers */
+	fl2k_notify_sample_worker(dev);
+	if (dev->cb)
+		pthread_join(dev->sample_worker_thread, NULL);
+
+	pthread_mutex_lock(&dev->buf_mutex);
+	while (fl2k_load_seq(&dev->xfer_acquired))
+		pthread_cond_wait(&dev->buf_cond, &dev->buf_mutex);
+	pthread_mutex_unlock(&dev->buf_mutex);
+
+	fl2k_thread_leave(dev, FL2K_THREAD_USB);
+	_fl2k_free_async_buffers(dev);
+	fl2k_store_seq(&dev->async_status, next_status);
+
+	pthread_exit(NULL);
+}
+
+/* Histogram bin of a duration, bin 0 is below 1 us, bin i covers
+ * [2^(i-1), 2^i) us and the last one everything above */
+static unsigned int fl2k_hist_bin(uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	unsigned int bin = 0;
+
+	while (us && bin < FL2K_STATS_HIST_BINS - 1) {
+		us >>= 1;
+		bin++;
+	}
+
+	return bin;
+}
+
+/* Account for a transfer filled by the sample producer, only one of them
+ * fills the transfers of a device at a time */
+static void fl2k_count_fill(fl2k_dev_t *dev, int called, uint64_t cb_ns,
+			    int converted, uint64_t conv_ns)
+{
+	double rate = fl2k_rate(dev);
+	uint64_t deadline = 0;
+	uint32_t bin;
+	int64_t slack;
+
+	/* the callback has to return within the time a buffer lasts */
+	if (called && rate > 0)
+		deadline = (uint64_t)((dev->xfer_buf_len / 3) * 1e9 / rate);
+
+	if (deadline) {
+		slack = (int64_t)deadline - (int64_t)cb_ns;
+
+		if (slack < dev->worst_slack)
+			fl2k_store_release64(&dev->worst_slack, slack);
+
+		if (slack < 0) {
+			fl2k_store_release64(&dev->deadline_misses,
+					     dev->deadline_misses + 1);
+
+			if (dev->deadline_hook)
+				dev->deadline_hook(dev->deadline_ctx, cb_ns,
+						   deadline);
+		}
+	}
+
+	if (called) {
+		if (!dev->cb_cnt || cb_ns < dev->cb_min)
+			fl2k_store_release64(&dev->cb_min, cb_ns);
+		if (cb_ns > dev->cb_max)
+			fl2k_store_release64(&dev->cb_max, cb_ns);
+
+		bin = fl2k_hist_bin(cb_ns);
+		fl2k_store_release64(&dev->cb_hist[bin], dev->cb_hist[bin] + 1);
+		fl2k_store_release64(&dev->cb_sum, dev->cb_sum + cb_ns);
+		fl2k_store_release64(&dev->cb_cnt, dev->cb_cnt + 1);
+	}
+
+	if (converted) {
+		if (conv_ns > dev->conv_max)
+			fl2k_store_release64(&dev->conv_max, conv_ns);
+
+		fl2k_store_release64(&dev->conv_sum, dev->conv_sum + conv_ns);
+		fl2k_store_release64(&dev->conv_cnt, dev->conv_cnt + 1);
+	}
+}
+
+/* Take over the DAC tables set since the last buffer */
+static void fl2k_update_luts(fl2k_dev_t *dev)
+{
+	if (!fl2k_load_acquire(&dev->lut_pending))
+		return;
+
+	pthread_mutex_lock(&dev->buf_mutex);
+	memcpy(dev->lut, dev->lut_next, sizeof(dev->lut));
+	memcpy(dev->lut_set, dev->lut_next_set, sizeof(dev->lut_set));
+	dev->lut_pending = 0;
+	pthread_mutex_unlock(&dev->buf_mutex);
+}
+
+/* Convert the samples of all DACs into transfer buffer out_buf */
+static void fl2k_convert_samples(fl2k_dev_t *dev, char *out_buf,
+				 fl2k_data_info_t *info)
+{
+	const void *in[3] = { info->r_buf, info->g_buf, info->b_buf };
+	int fmt[3] = { info->r_format, info->g_format, info->b_format };
+	const uint8_t *lut[3];
+	uint32_t i;
+
+	fl2k_update_luts(dev);
+
+	for (i = 0; i < 3; i++)
+		lut[i] = dev->lut_set[i] ? dev->lut[i] : NULL;
+
+	if (fmt[0] || fmt[1] || fmt[2] || lut[0] || lut[1] || lut[2])
+		fl2k_convert_formats(fl2k_convert_select(), out_buf, in, fmt,
+				     lut, info->sampletype_signed,
+				     dev->xfer_buf_len);
+	else
+		fl2k_convert_select()->convert_rgb(out_buf, info->r_buf,
+						   info->g_buf, info->b_buf,
+						   dev->xfer_buf_len,
+						   info->sampletype_signed ?
+						   128 : 0);
+}
+
+/* Get samples for transfer idx from the application */
+static void fl2k_fill_xfer(fl2k_dev_t *dev, uint32_t idx)
+{
+	char *out_buf = NULL;
+	fl2k_data_info_t data_info;
+	uint32_t underflow_cnt;
+	uint64_t t_cb, t_conv, t_end;
+
+	memset(&data_info, 0, sizeof(fl2k_data_info_t));
+
+	out_buf = (char *)dev->xfer_buf[idx];
+
+	underflow_cnt = fl2k_load_acquire(&dev->underflow_cnt);
+
+	data_info.len = dev->xfer_buf_len / 3;
+	data_info.underflow_cnt = underflow_cnt;
+	data_info.ctx = dev->cb_ctx;
+	data_info.using_zerocopy = dev->use_zerocopy;
+	data_info.raw_buf = out_buf;
+	data_info.raw_len = dev->xfer_buf_len;
+
+	if (underflow_cnt > dev->underflows) {
+		fprintf(stderr, "Underflow! Skipped %d buffers\n",
+				underflow_cnt - dev->underflows);
+		dev->underflows = underflow_cnt;
+	}
+
+	/* call application callback to get samples */
+	t_cb = fl2k_get_time_ns();
+	if (dev->cb)
+		dev->cb(&data_info);
+	t_conv = fl2k_get_time_ns();
+
+	dev->xfer_info[idx].timed = data_info.tx_timed;
+	dev->xfer_info[idx].target_tick = data_info.tx_timed ?
+					  data_info.tx_tick : 0;
+
+	/* Re-arrange and copy bytes in buffer for DACs, in a single
+	 * pass over the transfer buffer, unless the application
+	 * already wrote them in the native format */
+	if (!data_info.raw_filled)
+		fl2k_convert_samples(dev, out_buf, &data_info);
+	t_end = fl2k_get_time_ns();
+
+	fl2k_count_fill(dev, dev->cb != NULL, t_conv - t_cb,
+			!data_info.raw_filled, t_end - t_conv);
+}
+
+/* Fill the next empty transfer and queue it */
+static int fl2k_process_xfer(fl2k_dev_t *dev, int timeout_ms)
+{
+	uint32_t idx;
+	int r;
+
+	/* in the meantime, the device might be gone */
+	r = fl2k_wait_empty_xfer(dev, &idx, timeout_ms);
+	if (r < 0)
+		return r;
+
+	/* We have an empty USB transfer buffer */
+	fl2k_fill_xfer(dev, idx);
+
+	return fl2k_put_filled_xfer(dev, idx);
+}
+
+/* notify application if we've lost the device */
+static void fl2k_report_dev_lost(fl2k_dev_t *dev)
+{
+	fl2k_data_info_t data_info;
+
+	if (!fl2k_load_acquire(&dev->dev_lost) || !dev->cb)
+		return;
+
+	memset(&data_info, 0, sizeof(fl2k_data_info_t));
+	data_info.ctx = dev->cb_ctx;
+	data_info.device_error = 1;
+	dev->cb(&data_info);
+}
+
+static void *fl2k_sample_worker(void *arg)
+{
+	fl2k_dev_t *dev = (fl2k_dev_t *)arg;
+
+	fl2k_thread_enter(dev, FL2K_THREAD_SAMPLE);
+
+	while (FL2K_RUNNING == fl2k_load_seq(&dev->async_status)) {
+		if (fl2k_process_xfer(dev, -1) < 0)
+			break;
+	}
+
+	fl2k_report_dev_lost(dev);
+	fl2k_thread_leave(dev, FL2K_THREAD_SAMPLE);
+
+	pthread_exit(NULL);
+}
+
+/* Finish stopping a device serviced by the shared threads, returns 1 when
+ * it has been removed from the list */
+static int fl2k_pool_stop_dev(fl2k_dev_t *dev)
+{
+	fl2k_dev_t **p;
+	int busy;
+
+	if (FL2K_CANCELING == fl2k_load_seq(&dev->async_status) &&
+	    !dev->pool_cancelled) {
+		if (!fl2k_cancel_xfers(dev, &dev->pool_next_status))
+			return 0;
+
+		dev->pool_cancelled = 1;
+	}
+
+	/* wake up producers waiting for a buffer */
+	fl2k_notify_sample_worker(dev);
+
+	/* neither a pool worker nor the application may hold a transfer */
+	pthread_mutex_lock(&pool_lock);
+
+	busy = dev->pool_busy || fl2k_load_seq(&dev->xfer_acquired);
+
+	if (!busy) {
+		for (p = &pool_devs; *p != dev; p = &(*p)->pool_next)
+			;
+		*p = dev->pool_next;
+
+		if (pool_cursor == dev)
+			pool_cursor = dev->pool_next;
+	}
+
+	pthread_mutex_unlock(&pool_lock);
+
+	if (busy)
+		return 0;
+
+	fl2k_report_dev_lost(dev);
+	_fl2k_free_async_buffers(dev);
+
+	if (dev->pool_cancelled)
+		fl2k_store_seq(&dev->async_status, dev->pool_next_status);
+
+	/* the device may be freed from here on */
+	fl2k_store_release(&dev->shared, 0);
+
+	return 1;
+}
+
+/* The only thread handling the events of usb_ctx, as long as it exists.
+ * It runs the hotplug callback and the transfer callbacks of the devices
+ * serviced by the shared threads, and stops those devices. */
+static void *fl2k_usb_event_worker(void *arg)
+{
+	libusb_context *ctx = (libusb_context *)arg;
+	struct timeval tv = { 0, 100000 };
+	fl2k_dev_t *dev, *next;
+
+	while (fl2k_load_acquire(&usb_event_running)) {
+		libusb_handle_events_timeout_completed(ctx, &tv, &pool_wakeup);
+		fl2k_store_release(&pool_wakeup, 0);
+
+		pthread_mutex_lock(&pool_lock);
+		dev = pool_devs;
+		pthread_mutex_unlock(&pool_lock);
+
+		/* only this thread removes devices, so the list can be
+		 * walked without holding the lock */
+		for (; dev; dev = next) {
+			next = dev->pool_next;
+
+			if (FL2K_RUNNING != fl2k_load_seq(&dev->async_status))
+				fl2k_pool_stop_dev(dev);
+		}
+	}
+
+	return NULL;
+}
+
+/* Next device with an empty transfer and nobody filling it, pool_lock
+ * has to be held. Starts after the device serviced last, so that all of
+ * them get their turn if there are less workers than devices. */
+static fl2k_dev_t *fl2k_pool_next_dev(void)
+{
+	fl2k_dev_t *start = pool_cursor ? pool_cursor : pool_devs;
+	fl2k_dev_t *dev = start;
+
+	while (dev) {
+		if (dev->cb && !dev->pool_busy &&
+		    FL2K_RUNNING == fl2k_load_seq(&dev->async_status) &&
+		    fl2k_load_acquire(&dev->empty.tail) !=
+		    fl2k_load_acquire(&dev->empty.head))
+			return dev;
+
+		dev = dev->pool_next ? dev->pool_next : pool_devs;
+		if (dev == start)
+			break;
+	}
+
+	return NULL;
+}
+
+static void *fl2k_pool_worker(void *arg)
+{
+	fl2k_dev_t *dev;
+
+	pthread_mutex_lock(&pool_lock);
+
+	while (pool_running) {
+		dev = fl2k_pool_next_dev();
+		if (!dev) {
+			/* pairs with fl2k_wake_pool() */
+			fl2k_fetch_add(&pool_idle, 1);
+			fl2k_fence();
+
+			dev = fl2k_pool_next_dev();
+			if (!dev)
+				pthread_cond_wait(&pool_cond, &pool_lock);
+
+			fl2k_fetch_add(&pool_idle, -1);
+			continue;
+		}
+
+		dev->pool_busy = 1;
+		pool_cursor = dev->pool_next;
+		pthread_mutex_unlock(&pool_lock);
+
+		fl2k_process_xfer(dev, 0);
+
+		pthread_mutex_lock(&pool_lock);
+		dev->pool_busy = 0;
+	}
+
+	pthread_mutex_unlock(&pool_lock);
+
+	return NULL;
+}
+
+static void fl2k_reset_stats(fl2k_dev_t *dev)
+{
+	pthread_mutex_lock(&dev->buf_mutex);
+	dev->xfer_acquired = 0;
+	dev->wakeup_cnt = 0;
+	dev->wakeup_lat_sum = 0;
+	dev->wakeup_lat_max = 0;
+	dev->xfer_done = 0;
+	dev->xfer_done_time = 0;
+	dev->first_done_time = 0;
+	dev->xfer_in_flight = 0;
+	dev->xfer_depth = dev->xfer_num;
+	dev->depth_change_time = fl2k_get_time_ns();
+	dev->submit_tick = 0;
+	dev->usb_lat_sum = 0;
+	dev->usb_lat_max = 0;
+	dev->cb_cnt = 0;
+	dev->cb_sum = 0;
+	dev->cb_min = 0;
+	dev->cb_max = 0;
+	memset(dev->cb_hist, 0, sizeof(dev->cb_hist));
+	dev->conv_cnt = 0;
+	dev->conv_sum = 0;
+	dev->conv_max = 0;
+	dev->deadline_misses = 0;
+	dev->worst_slack = INT64_MAX;
+	pthread_mutex_unlock(&dev->buf_mutex);
+
+	dev->underflows = 0;
+	dev->underflow_cnt = 0;
+}
+
+static int fl2k_start_threads(fl2k_dev_t *dev)
+{
+	int r = 0;
+	pthread_attr_t attr;
+
+	/* hand the device over to the shared threads if it was opened
+	 * for them, fl2k_set_shared_threads() keeps them running */
+	pthread_mutex_lock(&pool_lock);
+
+	if (dev->pooled) {
+		dev->pool_busy = 0;
+		dev->pool_cancelled = 0;
+		dev->pool_next = pool_devs;
+		pool_devs = dev;
+		fl2k_store_release(&dev->shared, 1);
+		pthread_cond_broadcast(&pool_cond);
+	}
+
+	pthread_mutex_unlock(&pool_lock);
+
+	if (dev->shared)
+		return 0;
+
+	pthread_attr_init(&attr);
+
+	r = pthread_create(&dev->usb_worker_thread, &attr,
+			   fl2k_usb_worker, (void *)dev);
+	if (r < 0) {
+		fprintf(stderr, "Error spawning USB worker thread!\n");
+		goto out;
+	}
+
+	/* nobody waits for it, it frees the transfers on its own */
+	pthread_detach(dev->usb_worker_thread);
+
+	/* without a callback, the application pushes the samples itself */
+	if (dev->cb) {
+		r = pthread_create(&dev->sample_worker_thread, &attr,
+				   fl2k_sample_worker, (void *)dev);
+		if (r < 0)
+			fprintf(stderr, "Error spawning sample worker thread!\n");
+	}
+
+out:
+	pthread_attr_destroy(&attr);
+
+	return r;
+}
+
+static void fl2k_setup_tx(fl2k_dev_t *dev, fl2k_tx_cb_t cb, void *ctx,
+			  uint32_t buf_num)
+{
+	dev->cb = cb;
+	dev->cb_ctx = ctx;
+	dev->loop_xfers = 0;
+
+	if (buf_num > 0)
+		dev->xfer_num = buf_num;
+	else
+		dev->xfer_num = DEFAULT_BUF_NUMBER;
+
+	/* have two spare buffers that can be filled while the
+	 * others are submitted, plus the ones for growing the depth */
+	dev->xfer_depth_max = dev->xfer_num;
+	if (dev->buf_num_max > dev->xfer_num)
+		dev->xfer_depth_max = dev->buf_num_max;
+
+	dev->xfer_buf_num = dev->xfer_depth_max + 2;
+	dev->xfer_buf_len = dev->buf_len * 3;
+
+	/* enough fill transfers for all that can be in flight, for
+	 * underflows and for waiting for scheduled transfers */
+	dev->fill_xfer_num = dev->xfer_depth_max;
+}
+
+static int _fl2k_start(fl2k_dev_t *dev)
+{
+	int r = 0, err = 0;
+
+	fl2k_store_seq(&dev->async_status, FL2K_RUNNING);
+	fl2k_store_release(&dev->async_cancel, 0);
+	fl2k_reset_stats(dev);
+
+	r = fl2k_alloc_transfers(dev);
+	dev->loop_buf = NULL;
+	if (r < 0)
+		goto cleanup;
+
+	/* Nobody refills the transfers of a loop, a missing one would leave
+	 * a gap in the waveform. The USB worker cancels the ones already
+	 * submitted right away. */
+	r = fl2k_submit_transfers(dev);
+	if (r < 0 && dev->loop_xfers) {
+		err = (LIBUSB_ERROR_NO_DEVICE == r) ? FL2K_ERROR_NO_DEVICE :
+						       FL2K_ERROR_NO_MEM;
+		fl2k_stop_tx(dev);
+	}
+
+	r = fl2k_start_threads(dev);
+	if (r < 0)
+		goto cleanup;
+
+	if (err) {
+		while (FL2K_INACTIVE != fl2k_load_seq(&dev->async_status))
+			sleep_ms(1);
+
+		return err;
+	}
+
+	return 0;
+
+cleanup:
+	_fl2k_free_async_buffers(dev);
+	fl2k_store_seq(&dev->async_status, FL2K_INACTIVE);
+	return FL2K_ERROR_BUSY;
+}
+
+int fl2k_start_tx(fl2k_dev_t *dev, fl2k_tx_cb_t cb, void *ctx,
+		  uint32_t buf_num)
+{
+	if (!dev)
+		return FL2K_ERROR_INVALID_PARAM;
+
+	fl2k_setup_tx(dev, cb, ctx, buf_num);
+
+	return _fl2k_start(dev);
+}
+
+int fl2k_start_tx_loop(fl2k_dev_t *dev, const char *raw_buf,
+		       uint32_t xfer_cnt, uint32_t buf_num)
+{
+	if (!dev || !raw_buf || !xfer_cnt)
+		return FL2K_ERROR_INVALID_PARAM;
+
+	dev->cb = NULL;
+	dev->cb_ctx = NULL;
+	dev->loop_buf = raw_buf;
+	dev->loop_xfers = xfer_cnt;
+
+	if (!buf_num)
+		buf_num = DEFAULT_BUF_NUMBER;
+
+	/* all transfers stay in flight, use the smallest multiple of the
+	 * loop length that covers the requested buffer count */
+	dev->xfer_num = ((buf_num + xfer_cnt - 1) / xfer_cnt) * xfer_cnt;
+	dev->xfer_depth_max = dev->xfer_num;
+	dev->xfer_buf_num = dev->xfer_num;
+	dev->fill_xfer_num = 0;
+	dev->xfer_buf_len = dev->buf_len * 3;
+
+	return _fl2k_start(dev);
+}
+
+/* give up on the skew measurement if a device didn't complete a transfer */
+#define GROUP_START_TIMEOUT_MS	1000
+
+int fl2k_start_tx_group(fl2k_dev_t **devs, uint32_t num_devs,
+			fl2k_tx_cb_t cb, void **ctx, uint32_t buf_num,
+			int64_t *skew_ns)
+{
+	fl2k_dev_t *dev;
+	uint64_t first;
+	uint32_t i, k;
+	int r = 0, err = 0, done, waited = 0;
+
+	if (!devs || !num_devs)
+		return FL2K_ERROR_INVALID_PARAM;
+
+	for (i = 0; i < num_devs; i++) {
+		if (!devs[i])
+			return FL2K_ERROR_INVALID_PARAM;
 
-		/* if we allocate the memory through the Kernel, it is
-		 * already cleared */
-		if (!dev->use_zerocopy)
-			memset(dev->xfer_buf[i], 0, dev->xfer_buf_len);
+		if (FL2K_INACTIVE != fl2k_load_seq(&devs[i]->async_status))
+			return FL2K_ERROR_BUSY;
 	}
 
-	/* submit transfers */
-	for (i = 0; i < dev->xfer_num; ++i) {
-		r = libusb_submit_transfer(dev->xfer[i]);
-		dev->xfer_info[i].state = BUF_SUBMITTED;
+	/* allocate the transfers of all devices before anything is sent */
+	for (i = 0; i < num_devs; i++) {
+		dev = devs[i];
 
+		fl2k_setup_tx(dev, cb, ctx ? ctx[i] : NULL, buf_num);
+		fl2k_store_seq(&dev->async_status, FL2K_RUNNING);
+		fl2k_store_release(&dev->async_cancel, 0);
+		fl2k_reset_stats(dev);
+
+		r = fl2k_alloc_transfers(dev);
 		if (r < 0) {
-			fprintf(stderr, "Failed to submit transfer %i\n"
-					"Please increase your allowed " 
-					"usbfs buffer size with the "
-					"following command:\n"
-					"echo 0 > /sys/module/usbcore"
-					"/parameters/usbfs_memory_mb\n", i);
-			break;
+			for (k = 0; k <= i; k++) {
+				_fl2k_free_async_buffers(devs[k]);
+				fl2k_store_seq(&devs[k]->async_status,
+					       FL2K_INACTIVE);
+			}
+
+			return FL2K_ERROR_BUSY;
 		}
 	}
 
-	return 0;
-}
+	/* get the samples of the initially submitted transfers, which
+	 * stay zeroed for applications pushing their buffers */
+	for (i = 0; i < num_devs; i++) {
+		dev = devs[i];
 
-static int _fl2k_free_async_buffers(fl2k_dev_t *dev)
-{
-	unsigned int i;
+		for (k = 0; dev->cb && k < dev->xfer_num; k++)
+			fl2k_fill_xfer(dev, k);
 
-	if (!dev)
-		return FL2K_ERROR_INVALID_PARAM;
+		fl2k_queue_unsubmitted(dev);
+	}
 
-	if (dev->xfer) {
-		for (i = 0; i < dev->xfer_buf_num; ++i) {
-			if (dev->xfer[i]) {
-				libusb_free_transfer(dev->xfer[i]);
+	/* Submit the transfers in turns, so that all devices start with
+	 * the first transfer as close together as possible. A transfer
+	 * that fails to be submitted would leave its device behind the
+	 * others, so the whole group gets stopped again. */
+	for (k = 0; !err && k < devs[0]->xfer_num; k++) {
+		for (i = 0; i < num_devs; i++) {
+			r = fl2k_submit_xfer(devs[i], k);
+			if (r < 0) {
+				fprintf(stderr, "Failed to submit transfer %i "
+						"of device %i\n", k, i);
+				err = (LIBUSB_ERROR_NO_DEVICE == r) ?
+				      FL2K_ERROR_NO_DEVICE : FL2K_ERROR_NO_MEM;
+				break;
 			}
 		}
+	}
 
-		free(dev->xfer);
-		dev->xfer = NULL;
+	for (i = 0; i < num_devs; i++) {
+		r = fl2k_start_threads(devs[i]);
+		if (r < 0) {
+			for (k = 0; k < num_devs; k++)
+				fl2k_stop_tx(devs[k]);
+
+			return FL2K_ERROR_BUSY;
+		}
 	}
 
-	if (dev->xfer_buf) {
-		for (i = 0; i < dev->xfer_buf_num; ++i) {
-			if (dev->xfer_buf[i]) {
-				if (dev->use_zerocopy) {
-#if defined (__linux__) && LIBUSB_API_VERSION >= 0x01000105
-					libusb_dev_mem_free(dev->devh,
-							    dev->xfer_buf[i],
-							    dev->xfer_buf_len);
-#endif
-				} else {
-					free(dev->xfer_buf[i]);
-				}
-			}
+	/* the USB workers cancel what has been submitted, once the
+	 * sample workers they wait for exist */
+	if (err) {
+		for (i = 0; i < num_devs; i++)
+			fl2k_stop_tx(devs[i]);
+
+		for (i = 0; i < num_devs; i++) {
+			while (FL2K_INACTIVE !=
+			       fl2k_load_seq(&devs[i]->async_status))
+				sleep_ms(1);
 		}
 
-		free(dev->xfer_buf);
-		dev->xfer_buf = NULL;
+		return err;
 	}
 
+	if (!skew_ns)
+		return 0;
+
+	/* measure the skew by the completion of the first transfers */
+	do {
+		sleep_ms(1);
+
+		for (i = 0, done = 1; i < num_devs; i++)
+			done &= (fl2k_load_acquire64(&devs[i]->xfer_done) > 0);
+	} while (!done && ++waited < GROUP_START_TIMEOUT_MS);
+
+	if (!done)
+		return FL2K_ERROR_TIMEOUT;
+
+	first = fl2k_load_acquire64(&devs[0]->first_done_time);
+
+	for (i = 0; i < num_devs; i++)
+		skew_ns[i] = (int64_t)(fl2k_load_acquire64(
+				&devs[i]->first_done_time) - first);
+
 	return 0;
 }
 
-static void *fl2k_usb_worker(void *arg)
+int fl2k_stop_tx(fl2k_dev_t *dev)
 {
-	fl2k_dev_t *dev = (fl2k_dev_t *)arg;
-	struct timeval tv = { 1, 0 };
-	struct timeval zerotv = { 0, 0 };
-	enum fl2k_async_status next_status = FL2K_INACTIVE;
+	if (!dev)
+		return FL2K_ERROR_INVALID_PARAM;
+
+	/* if streaming, try to cancel gracefully */
+	if (FL2K_RUNNING == fl2k_load_seq(&dev->async_status)) {
+		fl2k_store_seq(&dev->async_status, FL2K_CANCELING);
+		fl2k_store_release(&dev->async_cancel, 1);
+		if (fl2k_load_acquire(&dev->shared))
+			fl2k_store_release(&pool_wakeup, 1);
+		if (dev->routed)
+			fl2k_wake_usb_worker(dev);
+		return 0;
+	/* if called while in pending state, change the state forcefully */
+	} else if (FL2K_INACTIVE != fl2k_load_seq(&dev->async_status)) {
+		fl2k_store_seq(&dev->async_status, FL2K_INACTIVE);
+		return 0;
+	}
+
+	return FL2K_ERROR_BUSY;
+}
+
+int fl2k_set_shared_threads(uint32_t num_workers)
+{
+	pthread_attr_t attr;
+	uint32_t i;
 	int r = 0;
-	unsigned int i;
 
-	while (FL2K_RUNNING == dev->async_status) {
-		r = libusb_handle_events_timeout_completed(dev->ctx, &tv,
-							   &dev->async_cancel);
+	pthread_mutex_lock(&pool_config_lock);
+	pthread_mutex_lock(&pool_lock);
+
+	/* the devices on usb_ctx have no threads of their own */
+	if (pool_open_devs) {
+		pthread_mutex_unlock(&pool_lock);
+		pthread_mutex_unlock(&pool_config_lock);
+		return FL2K_ERROR_BUSY;
 	}
 
-	while (FL2K_INACTIVE != dev->async_status) {
-		r = libusb_handle_events_timeout_completed(dev->ctx, &tv,
-							   &dev->async_cancel);
-		if (r < 0) {
-			/*fprintf(stderr, "handle_events returned: %d\n", r);*/
-			if (r == LIBUSB_ERROR_INTERRUPTED) /* stray signal */
-				continue;
+	/* stop the threads of the previous configuration */
+	if (pool_running) {
+		pool_running = 0;
+		pthread_cond_broadcast(&pool_cond);
+		pthread_mutex_unlock(&pool_lock);
+
+		for (i = 0; i < pool_size; i++)
+			pthread_join(pool_threads[i], NULL);
+
+		free(pool_threads);
+		pool_threads = NULL;
+		pool_size = 0;
+	} else {
+		pthread_mutex_unlock(&pool_lock);
+	}
+
+	if (!num_workers)
+		goto out;
+
+	pool_threads = malloc(num_workers * sizeof(pthread_t));
+	if (!pool_threads) {
+		r = FL2K_ERROR_NO_MEM;
+		goto out;
+	}
+
+	/* devices can only be opened for the pool once it is up */
+	pthread_mutex_lock(&pool_lock);
+	pool_running = 1;
+	pthread_attr_init(&attr);
+
+	for (pool_size = 0; pool_size < num_workers; pool_size++) {
+		r = pthread_create(&pool_threads[pool_size], &attr,
+				   fl2k_pool_worker, NULL);
+		if (r) {
+			fprintf(stderr, "Error spawning sample worker thread!\n");
 			break;
 		}
+	}
 
-		if (FL2K_CANCELING == dev->async_status) {
-			next_status = FL2K_INACTIVE;
+	pthread_attr_destroy(&attr);
 
-			if (!dev->xfer)
-				break;
+	/* make do with the workers we got */
+	if (!pool_size)
+		pool_running = 0;
 
-			for (i = 0; i < dev->xfer_buf_num; ++i) {
-				if (!dev->xfer[i])
-					continue;
-
-				if (LIBUSB_TRANSFER_CANCELLED !=
-						dev->xfer[i]->status) {
-					r = libusb_cancel_transfer(dev->xfer[i]);
-					/* handle events after canceling
-					 * to allow transfer status to
-					 * propagate */
-					libusb_handle_events_timeout_completed(dev->ctx,
-									       &zerotv, NULL);
-					if (r < 0)
-						continue;
-
-					next_status = FL2K_CANCELING;
-				}
-			}
+	pthread_mutex_unlock(&pool_lock);
 
-			if (dev->dev_lost || FL2K_INACTIVE == next_status) {
-				/* handle any events that still need to
-				 * be handled before exiting after we
-				 * just cancelled all transfers */
-				libusb_handle_events_timeout_completed(dev->ctx,
-								       &zerotv, NULL);
-				break;
-			}
-		}
+	if (!pool_size) {
+		free(pool_threads);
+		pool_threads = NULL;
+		r = FL2K_ERROR_BUSY;
+		goto out;
 	}
 
-	/* wait for sample worker thread to finish before freeing buffers */
-	pthread_join(dev->sample_worker_thread, NULL);  
-	_fl2k_free_async_buffers(dev);
-	dev->async_status = next_status;
+	r = 0;
+out:
+	pthread_mutex_unlock(&pool_config_lock);
+	return r;
+}
 
-	pthread_exit(NULL);
+int fl2k_set_adaptive_buf_num(fl2k_dev_t *dev, uint32_t max_buf_num)
+{
+	if (!dev)
+		return FL2K_ERROR_INVALID_PARAM;
+
+	if (FL2K_INACTIVE != fl2k_load_seq(&dev->async_status))
+		return FL2K_ERROR_BUSY;
+
+	dev->buf_num_max = max_buf_num;
+
+	return 0;
 }
 
-/* Buffer format conversion functions for R, G, B DACs */
-static inline void fl2k_convert_r(char *out,
-				  char *in,
-				  uint32_t len,
-				  uint8_t offset)
+int fl2k_set_underflow_policy(fl2k_dev_t *dev, int policy)
 {
-	unsigned int i, j = 0;
+	if (!dev || policy < FL2K_UNDERFLOW_REPEAT ||
+	    policy > FL2K_UNDERFLOW_HOLD)
+		return FL2K_ERROR_INVALID_PARAM;
 
-	if (!in || !out)
-		return;
+	if (FL2K_INACTIVE != fl2k_load_seq(&dev->async_status))
+		return FL2K_ERROR_BUSY;
 
-	for (i = 0; i < len; i += 24) {
-		out[i+ 6] = in[j++] + offset;
-		out[i+ 1] = in[j++] + offset;
-		out[i+12] = in[j++] + offset;
-		out[i+15] = in[j++] + offset;
-		out[i+10] = in[j++] + offset;
-		out[i+21] = in[j++] + offset;
-		out[i+16] = in[j++] + offset;
-		out[i+19] = in[j++] + offset;
-	}
+	dev->underflow_policy = policy;
+
+	return 0;
 }
 
-static inline void fl2k_convert_g(char *out,
-				  char *in,
-				  uint32_t len,
-				  uint8_t offset)
+int fl2k_set_dac_lut(fl2k_dev_t *dev, uint32_t dac, const uint8_t *lut)
 {
-	unsigned int i, j = 0;
+	if (!dev || dac > 2)
+		return FL2K_ERROR_INVALID_PARAM;
 
-	if (!in || !out)
-		return;
+	pthread_mutex_lock(&dev->buf_mutex);
 
-	for (i = 0; i < len; i += 24) {
-		out[i+ 5] = in[j++] + offset;
-		out[i+ 0] = in[j++] + offset;
-		out[i+ 3] = in[j++] + offset;
-		out[i+14] = in[j++] + offset;
-		out[i+ 9] = in[j++] + offset;
-		out[i+20] = in[j++] + offset;
-		out[i+23] = in[j++] + offset;
-		out[i+18] = in[j++] + offset;
-	}
+	if (lut)
+		memcpy(dev->lut_next[dac], lut, sizeof(dev->lut_next[dac]));
+
+	dev->lut_next_set[dac] = (lut != NULL);
+	fl2k_store_release(&dev->lut_pending, 1);
+	pthread_mutex_unlock(&dev->buf_mutex);
+
+	return 0;
 }
 
-static inline void fl2k_convert_b(char *out,
-				  char *in,
-				  uint32_t len,
-				  uint8_t offset)
+int fl2k_set_dac_gain(fl2k_dev_t *dev, uint32_t dac, double gain,
+		      double offset)
 {
-	unsigned int i, j = 0;
+	uint8_t lut[256];
+	double v;
+	int i;
 
-	if (!in || !out)
-		return;
+	for (i = 0; i < 256; i++) {
+		v = gain * i + offset;
 
-	for (i = 0; i < len; i += 24) {
-		out[i+ 4] = in[j++] + offset;
-		out[i+ 7] = in[j++] + offset;
-		out[i+ 2] = in[j++] + offset;
-		out[i+13] = in[j++] + offset;
-		out[i+ 8] = in[j++] + offset;
-		out[i+11] = in[j++] + offset;
-		out[i+22] = in[j++] + offset;
-		out[i+17] = in[j++] + offset;
+		/* also maps NaN to 0 */
+		if (!(v > 0))
+			v = 0;
+		else if (v > 255)
+			v = 255;
+
+		lut[i] = (uint8_t)(v + 0.5);
 	}
+
+	return fl2k_set_dac_lut(dev, dac, lut);
 }
 
-static void *fl2k_sample_worker(void *arg)
+uint32_t fl2k_get_buf_num(fl2k_dev_t *dev)
 {
-	int r = 0;
-	unsigned int i, j;
-	fl2k_dev_t *dev = (fl2k_dev_t *)arg;
-	fl2k_xfer_info_t *xfer_info = NULL;
-	struct libusb_transfer *xfer = NULL;
-	char *out_buf = NULL;
-	fl2k_data_info_t data_info;
-	uint32_t underflows = 0;
-	uint64_t buf_cnt = 0;
+	uint32_t depth;
+
+	if (!dev)
+		return 0;
 
-	while (FL2K_RUNNING == dev->async_status) {
-		memset(&data_info, 0, sizeof(fl2k_data_info_t));
+	depth = (FL2K_INACTIVE != fl2k_load_seq(&dev->async_status)) ?
+		fl2k_load_acquire(&dev->xfer_depth) : 0;
 
-		data_info.len = FL2K_BUF_LEN;
-		data_info.underflow_cnt = dev->underflow_cnt;
-		data_info.ctx = dev->cb_ctx;
+	return depth;
+}
 
-		if (dev->underflow_cnt > underflows) {
-			fprintf(stderr, "Underflow! Skipped %d buffers\n",
-					dev->underflow_cnt - underflows);
-			underflows = dev->underflow_cnt;
-		}
+int fl2k_acquire_tx_buffer(fl2k_dev_t *dev, char **buf, int timeout_ms)
+{
+	uint32_t idx;
+	int r;
 
-		/* call application callback to get samples */
-		if (dev->cb)
-			dev->cb(&data_info);
+	if (!dev || !buf)
+		return FL2K_ERROR_INVALID_PARAM;
 
-		xfer = fl2k_get_next_xfer(dev, BUF_EMPTY);
+	/* the sample worker owns the transfers in callback mode, and
+	 * there are none to be filled in loop mode */
+	if (dev->cb || dev->loop_xfers)
+		return FL2K_ERROR_BUSY;
 
-		if (!xfer) {
-			pthread_cond_wait(&dev->buf_cond, &dev->buf_mutex);
-			/* in the meantime, the device might be gone */
-			if (FL2K_RUNNING != dev->async_status)
-				break;
+	/* the empty ring has a single consumer */
+	if (!fl2k_cas(&dev->acquiring, 0, 1))
+		return FL2K_ERROR_BUSY;
 
-			xfer = fl2k_get_next_xfer(dev, BUF_EMPTY);
-			if (!xfer) {
-				fprintf(stderr, "no free transfer, skipping"
-						" input buffer\n");
-				continue;
-			}
-		}
+	r = fl2k_wait_empty_xfer(dev, &idx, timeout_ms);
+	if (!r) {
+		fl2k_store_release(&dev->xfer_info[idx].acquired, 1);
+		*buf = (char *)dev->xfer_buf[idx];
+	}
 
-		/* We have an empty USB transfer buffer */
-		xfer_info = (fl2k_xfer_info_t *)xfer->user_data;
-		out_buf = (char *)xfer->buffer;
+	fl2k_store_release(&dev->acquiring, 0);
 
-		/* Re-arrange and copy bytes in buffer for DACs */
-		fl2k_convert_r(out_buf, data_info.r_buf, dev->xfer_buf_len,
-			       data_info.sampletype_signed ? 128 : 0);
+	return r;
+}
 
-		fl2k_convert_g(out_buf, data_info.g_buf, dev->xfer_buf_len,
-			       data_info.sampletype_signed ? 128 : 0);
+static int fl2k_submit_buffer(fl2k_dev_t *dev, char *buf, uint64_t tick,
+			      int timed)
+{
+	uint32_t i;
+	int r = FL2K_ERROR_INVALID_PARAM;
 
-		fl2k_convert_b(out_buf, data_info.b_buf, dev->xfer_buf_len,
-			       data_info.sampletype_signed ? 128 : 0);
+	if (!dev || !buf || dev->cb || !dev->xfer_buf)
+		return FL2K_ERROR_INVALID_PARAM;
 
-		xfer_info->seq = buf_cnt++;
-		xfer_info->state = BUF_FILLED;
-	}
+	/* the filled ring has a single producer */
+	if (!fl2k_cas(&dev->submitting, 0, 1))
+		return FL2K_ERROR_BUSY;
 
-	/* notify application if we've lost the device */
-	if (dev->dev_lost && dev->cb) {
-		data_info.device_error = 1;
-		dev->cb(&data_info);
+	for (i = 0; i < dev->xfer_buf_num; i++) {
+		if ((char *)dev->xfer_buf[i] != buf)
+			continue;
+
+		/* a buffer submitted twice would be queued twice */
+		if (fl2k_cas(&dev->xfer_info[i].acquired, 1, 0)) {
+			dev->xfer_info[i].target_tick = tick;
+			dev->xfer_info[i].timed = timed;
+			r = fl2k_put_filled_xfer(dev, i);
+		}
+
+		break;
 	}
 
-	pthread_exit(NULL);
+	fl2k_store_release(&dev->submitting, 0);
+
+	return r;
 }
 
+int fl2k_submit_tx_buffer(fl2k_dev_t *dev, char *buf)
+{
+	return fl2k_submit_buffer(dev, buf, 0, 0);
+}
 
-int fl2k_start_tx(fl2k_dev_t *dev, fl2k_tx_cb_t cb, void *ctx,
-		  uint32_t buf_num)
+int fl2k_submit_tx_buffer_at(fl2k_dev_t *dev, char *buf, uint64_t tick)
 {
-	int r = 0;
-	int i;
-	pthread_attr_t attr;
+	if (!dev || !dev->xfer_buf)
+		return FL2K_ERROR_INVALID_PARAM;
 
-	if (!dev || !cb)
+	/* transfers only start on buffer boundaries */
+	if (tick % (dev->xfer_buf_len / 3))
 		return FL2K_ERROR_INVALID_PARAM;
 
-	dev->async_status = FL2K_RUNNING;
-	dev->async_cancel = 0;
+	return fl2k_submit_buffer(dev, buf, tick, 1);
+}
 
-	dev->cb = cb;
-	dev->cb_ctx = ctx;
+int fl2k_get_sample_count(fl2k_dev_t *dev, uint64_t *count,
+			  uint64_t *timestamp_ns)
+{
+	if (!dev)
+		return FL2K_ERROR_INVALID_PARAM;
 
-	if (buf_num > 0)
-		dev->xfer_num = buf_num;
-	else
-		dev->xfer_num = DEFAULT_BUF_NUMBER;
+	if (count)
+		*count = fl2k_load_acquire64(&dev->xfer_done) *
+			 (dev->xfer_buf_len / 3);
 
-	/* have two spare buffers that can be filled while the
-	 * others are submitted */
-	dev->xfer_buf_num = dev->xfer_num + 2;
-	dev->xfer_buf_len = FL2K_XFER_LEN;
+	if (timestamp_ns)
+		*timestamp_ns = fl2k_load_acquire64(&dev->xfer_done_time);
 
-	r = fl2k_alloc_submit_transfers(dev);
-	if (r < 0)
-		goto cleanup;
+	return 0;
+}
 
-	pthread_mutex_init(&dev->buf_mutex, NULL);
-	pthread_cond_init(&dev->buf_cond, NULL);
-	pthread_attr_init(&attr);
+int fl2k_get_stats(fl2k_dev_t *dev, fl2k_stats_t *stats)
+{
+	uint64_t done, cb_cnt, conv_cnt;
+	int64_t worst_slack;
+	uint32_t head, tail, i;
 
-	r = pthread_create(&dev->usb_worker_thread, &attr,
-			   fl2k_usb_worker, (void *)dev);
-	if (r < 0) {
-		fprintf(stderr, "Error spawning USB worker thread!\n");
-		goto cleanup;
-	}
+	if (!dev || !stats)
+		return FL2K_ERROR_INVALID_PARAM;
 
-	r = pthread_create(&dev->sample_worker_thread, &attr,
-			   fl2k_sample_worker, (void *)dev);
-	if (r < 0) {
-		fprintf(stderr, "Error spawning sample worker thread!\n");
-		goto cleanup;
-	}
+	memset(stats, 0, sizeof(fl2k_stats_t));
 
-	pthread_attr_destroy(&attr);
+	/* the counters are read first, so the sums are at least as recent */
+	done = fl2k_load_acquire64(&dev->xfer_done);
+	cb_cnt = fl2k_load_acquire64(&dev->cb_cnt);
+	conv_cnt = fl2k_load_acquire64(&dev->conv_cnt);
+
+	stats->xfers_completed = done;
+	stats->bytes_sent = done * dev->xfer_buf_len;
+
+	stats->cb_count = cb_cnt;
+	stats->cb_min_ns = fl2k_load_acquire64(&dev->cb_min);
+	stats->cb_avg_ns = cb_cnt ?
+			   fl2k_load_acquire64(&dev->cb_sum) / cb_cnt : 0;
+	stats->cb_max_ns = fl2k_load_acquire64(&dev->cb_max);
+	for (i = 0; i < FL2K_STATS_HIST_BINS; i++)
+		stats->cb_hist[i] = fl2k_load_acquire64(&dev->cb_hist[i]);
+
+	stats->conv_avg_ns = conv_cnt ?
+			     fl2k_load_acquire64(&dev->conv_sum) / conv_cnt : 0;
+	stats->conv_max_ns = fl2k_load_acquire64(&dev->conv_max);
+
+	stats->usb_lat_avg_ns = done ?
+				fl2k_load_acquire64(&dev->usb_lat_sum) / done : 0;
+	stats->usb_lat_max_ns = fl2k_load_acquire64(&dev->usb_lat_max);
+
+	fl2k_get_wakeup_latency(dev, &stats->wakeup_avg_ns,
+				&stats->wakeup_max_ns);
+
+	stats->xfers_in_flight = fl2k_load_acquire(&dev->xfer_in_flight);
+
+	stats->deadline_misses = fl2k_load_acquire64(&dev->deadline_misses);
+	worst_slack = (int64_t)fl2k_load_acquire64(&dev->worst_slack);
+	stats->worst_slack_ns = (worst_slack == INT64_MAX) ? 0 : worst_slack;
+
+	stats->underflows = fl2k_load_acquire(&dev->underflow_cnt);
+
+	/* filled transfers waiting to be submitted */
+	tail = fl2k_load_acquire(&dev->filled.tail);
+	head = fl2k_load_acquire(&dev->filled.head);
+	stats->xfers_queued = head - tail;
 
 	return 0;
+}
 
-cleanup:
-	_fl2k_free_async_buffers(dev);
-	return FL2K_ERROR_BUSY;
+/* The hooks are called without locking, so they can't be changed while
+ * streaming */
+int fl2k_set_deadline_hook(fl2k_dev_t *dev, fl2k_deadline_hook_t hook,
+			   void *ctx)
+{
+	if (!dev)
+		return FL2K_ERROR_INVALID_PARAM;
+
+	if (FL2K_INACTIVE != fl2k_load_seq(&dev->async_status))
+		return FL2K_ERROR_BUSY;
 
+	dev->deadline_hook = hook;
+	dev->deadline_ctx = ctx;
+
+	return 0;
 }
 
-int fl2k_stop_tx(fl2k_dev_t *dev)
+int fl2k_set_tx_done_hook(fl2k_dev_t *dev, fl2k_tx_done_hook_t hook,
+			  void *ctx)
 {
 	if (!dev)
 		return FL2K_ERROR_INVALID_PARAM;
 
-	/* if streaming, try to cancel gracefully */
-	if (FL2K_RUNNING == dev->async_status) {
-		dev->async_status = FL2K_CANCELING;
-		dev->async_cancel = 1;
-		return 0;
-	/* if called while in pending state, change the state forcefully */
-	} else if (FL2K_INACTIVE != dev->async_status) {
-		dev->async_status = FL2K_INACTIVE;
-		return 0;
+	if (FL2K_INACTIVE != fl2k_load_seq(&dev->async_status))
+		return FL2K_ERROR_BUSY;
+
+	dev->tx_done_hook = hook;
+	dev->tx_done_ctx = ctx;
+
+	return 0;
+}
+
+int fl2k_get_wakeup_latency(fl2k_dev_t *dev, uint64_t *avg_ns,
+			    uint64_t *max_ns)
+{
+	if (!dev)
+		return FL2K_ERROR_INVALID_PARAM;
+
+	pthread_mutex_lock(&dev->buf_mutex);
+
+	if (avg_ns)
+		*avg_ns = dev->wakeup_cnt ?
+			  dev->wakeup_lat_sum / dev->wakeup_cnt : 0;
+
+	if (max_ns)
+		*max_ns = dev->wakeup_lat_max;
+
+	pthread_mutex_unlock(&dev->buf_mutex);
+
+	return 0;
+}
+
+int fl2k_set_thread_sched(fl2k_dev_t *dev, int thread, int policy,
+			  int priority, int nice, uint64_t cpu_mask)
+{
+	fl2k_thread_cfg_t *cfg, old;
+	int sys_policy, r = 0;
+
+	if (!dev || thread < 0 || thread >= FL2K_THREAD_NUM)
+		return FL2K_ERROR_INVALID_PARAM;
+
+	switch (policy) {
+	case FL2K_SCHED_OTHER:
+		if (priority)
+			return FL2K_ERROR_INVALID_PARAM;
+		break;
+	case FL2K_SCHED_FIFO:
+	case FL2K_SCHED_RR:
+		sys_policy = (FL2K_SCHED_FIFO == policy) ? SCHED_FIFO : SCHED_RR;
+		if (priority < sched_get_priority_min(sys_policy) ||
+		    priority > sched_get_priority_max(sys_policy))
+			return FL2K_ERROR_INVALID_PARAM;
+		break;
+	default:
+		return FL2K_ERROR_INVALID_PARAM;
 	}
 
-	return FL2K_ERROR_BUSY;
+	if (nice < -20 || nice > 19)
+		return FL2K_ERROR_INVALID_PARAM;
+
+#ifndef __linux__
+	if (nice || cpu_mask)
+		return FL2K_ERROR_NOT_SUPPORTED;
+#endif
+
+	pthread_mutex_lock(&dev->buf_mutex);
+
+	cfg = &dev->thread_cfg[thread];
+	old = *cfg;
+	cfg->set = 1;
+	cfg->policy = policy;
+	cfg->priority = priority;
+	cfg->nice = nice;
+	cfg->cpu_mask = cpu_mask;
+
+	if (dev->thread_running[thread]) {
+		r = fl2k_sched_thread(cfg, dev->thread_self[thread],
+				      dev->thread_tid[thread]);
+		if (r < 0)
+			*cfg = old;
+	}
+
+	pthread_mutex_unlock(&dev->buf_mutex);
+
+	return r;
 }
 
 int fl2k_i2c_read(fl2k_dev_t *dev, uint8_t i2c_addr, uint8_t reg_addr, uint8_t *data)
@@ -1014,6 +3286,10 @@ int fl2k_i2c_read(fl2k_dev_t *dev, uint8_t i2c_addr, uint8_t reg_addr, uint8_t *
 	if (!dev)
 		return FL2K_ERROR_INVALID_PARAM;
 
+	/* no monitor is connected to the virtual device */
+	if (dev->virt)
+		return FL2K_ERROR_NOT_SUPPORTED;
+
 	r = fl2k_read_reg(dev, 0x8020, &reg);
 	if (r < 0)
 		return r;
@@ -1062,6 +3338,9 @@ int fl2k_i2c_write(fl2k_dev_t *dev, uint8_t i2c_addr, uint8_t reg_addr, uint8_t
 	if (!dev)
 		return FL2K_ERROR_INVALID_PARAM;
 
+	if (dev->virt)
+		return FL2K_ERROR_NOT_SUPPORTED;
+
 	/* write data to register 0x8028 */
 	r = libusb_control_transfer(dev->devh, CTRL_OUT, 0x41,
 				    0, 0x8028, data, 4, CTRL_TIMEOUT);
@@ -0,0 +1,92 @@
+/*
+ * osmo-fl2k, turns FL2000-based USB 3.0 to VGA adapters into
+ * low cost DACs
+ *
+ * Copyright (C) 2016-2018 by Steve Markgraf <steve@steve-m.de>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread_opts.h"
+
+int thread_opts_parse(thread_opts_t *opts, int opt, const char *arg)
+{
+	char *end;
+
+	switch (opt) {
+	case 'P':
+		if (!strncmp(arg, "fifo:", 5)) {
+			opts->policy = FL2K_SCHED_FIFO;
+			arg += 5;
+		} else if (!strncmp(arg, "rr:", 3)) {
+			opts->policy = FL2K_SCHED_RR;
+			arg += 3;
+		} else {
+			return -1;
+		}
+
+		opts->priority = (int)strtol(arg, &end, 10);
+		if (end == arg || *end)
+			return -1;
+		break;
+	case 'N':
+		opts->nice = (int)strtol(arg, &end, 10);
+		if (end == arg || *end)
+			return -1;
+		break;
+	case 'A':
+		opts->cpu_mask = strtoull(arg, &end, 16);
+		if (end == arg || *end || !opts->cpu_mask)
+			return -1;
+		break;
+	default:
+		return -1;
+	}
+
+	opts->set = 1;
+
+	return 0;
+}
+
+int thread_opts_apply(thread_opts_t *opts, fl2k_dev_t *dev)
+{
+	int thread, r;
+
+	if (!opts->set)
+		return 0;
+
+	for (thread = FL2K_THREAD_USB; thread <= FL2K_THREAD_SAMPLE; thread++) {
+		r = fl2k_set_thread_sched(dev, thread, opts->policy,
+					  opts->priority, opts->nice,
+					  opts->cpu_mask);
+		if (FL2K_ERROR_NOT_SUPPORTED == r) {
+			fprintf(stderr, "Nice levels and CPU affinity are not "
+				"supported on this platform.\n");
+			return r;
+		} else if (r < 0) {
+			fprintf(stderr, "Invalid thread scheduling settings, "
+				"check the priority range of the policy.\n");
+			return r;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,341 @@
+/*
+ * osmo-fl2k, turns FL2000-based USB 3.0 to VGA adapters into
+ * low cost DACs
+ *
+ * Copyright (C) 2016-2018 by Steve Markgraf <steve@steve-m.de>
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#else
+#include <windows.h>
+#include <sys/timeb.h>
+#endif
+
+#include "virtual.h"
+
+/* the completion flag is set by other threads, like libusb reads it */
+#if defined(_MSC_VER)
+#define fl2k_virtual_flag(p)	(*(volatile int *)(p))
+#else
+#define fl2k_virtual_flag(p)	__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#endif
+
+typedef struct fl2k_virtual_xfer {
+	struct libusb_transfer *xfer;
+	uint64_t due;			/* completion time */
+	int cancelled;
+} fl2k_virtual_xfer_t;
+
+struct fl2k_virtual {
+	FILE *sink;			/* NULL for the null sink */
+
+	/* submitted transfers in order, protected by lock */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	fl2k_virtual_xfer_t *queue;
+	uint32_t queue_len;
+	uint32_t queue_size;
+
+	/* the samples are paced from start_time on, as long as the queue
+	 * doesn't run empty and the rate stays the same */
+	double rate;
+	uint64_t start_time;
+	uint64_t samples;
+	uint64_t last_due;
+};
+
+/* monotonic time in nanoseconds */
+static uint64_t fl2k_virtual_time_ns(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, cnt;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&cnt);
+
+	return (uint64_t)(cnt.QuadPart / freq.QuadPart) * 1000000000ULL +
+	       (uint64_t)(cnt.QuadPart % freq.QuadPart) * 1000000000ULL /
+	       freq.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/* Wait for the condition at most timeout_ns, lock has to be held */
+static void fl2k_virtual_wait(fl2k_virtual_t *virt, uint64_t timeout_ns)
+{
+	struct timespec ts;
+
+#ifdef _WIN32
+	struct _timeb tb;
+
+	_ftime(&tb);
+	ts.tv_sec = tb.time;
+	ts.tv_nsec = tb.millitm * 1000000L;
+#else
+	clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+	ts.tv_sec += timeout_ns / 1000000000ULL;
+	ts.tv_nsec += timeout_ns % 1000000000ULL;
+
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+
+	pthread_cond_timedwait(&virt->cond, &virt->lock, &ts);
+}
+
+int fl2k_virtual_enabled(void)
+{
+	const char *cfg = getenv(FL2K_VIRTUAL_ENV);
+
+	return cfg && cfg[0];
+}
+
+fl2k_virtual_t *fl2k_virtual_open(void)
+{
+	const char *cfg = getenv(FL2K_VIRTUAL_ENV);
+	const char *path = NULL;
+	fl2k_virtual_t *virt;
+
+	if (!cfg || !cfg[0])
+		return NULL;
+
+	if (!strncmp(cfg, "file:", 5)) {
+		path = cfg + 5;
+	} else if (!strncmp(cfg, "fifo:", 5)) {
+		path = cfg + 5;
+#ifndef _WIN32
+		if (mkfifo(path, 0666) < 0 && errno != EEXIST) {
+			fprintf(stderr, "Failed to create FIFO %s\n", path);
+			return NULL;
+		}
+#else
+		fprintf(stderr, "FIFOs are not supported on Windows\n");
+		return NULL;
+#endif
+	} else if (strcmp(cfg, "null")) {
+		fprintf(stderr, "Unknown virtual device sink '%s', use null, "
+				"file:<path> or fifo:<path>\n", cfg);
+		return NULL;
+	}
+
+	virt = calloc(1, sizeof(fl2k_virtual_t));
+	if (!virt)
+		return NULL;
+
+	if (path) {
+		virt->sink = fopen(path, "wb");
+		if (!virt->sink) {
+			fprintf(stderr, "Failed to open %s\n", path);
+			free(virt);
+			return NULL;
+		}
+	}
+
+	pthread_mutex_init(&virt->lock, NULL);
+	pthread_cond_init(&virt->cond, NULL);
+
+	return virt;
+}
+
+void fl2k_virtual_close(fl2k_virtual_t *virt)
+{
+	if (!virt)
+		return;
+
+	if (virt->sink)
+		fclose(virt->sink);
+
+	pthread_mutex_destroy(&virt->lock);
+	pthread_cond_destroy(&virt->cond);
+	free(virt->queue);
+	free(virt);
+}
+
+int fl2k_virtual_submit(fl2k_virtual_t *virt, struct libusb_transfer *xfer,
+			uint32_t samples, double rate)
+{
+	fl2k_virtual_xfer_t *queue;
+	uint64_t now = fl2k_virtual_time_ns();
+	uint32_t size;
+
+	pthread_mutex_lock(&virt->lock);
+
+	if (virt->queue_len == virt->queue_size) {
+		size = virt->queue_size ? virt->queue_size * 2 : 16;
+		queue = realloc(virt->queue, size * sizeof(*queue));
+		if (!queue) {
+			pthread_mutex_unlock(&virt->lock);
+			return LIBUSB_ERROR_NO_MEM;
+		}
+
+		virt->queue = queue;
+		virt->queue_size = size;
+	}
+
+	/* like the device, the output stalls when running out of data */
+	if (!virt->queue_len && virt->last_due < now) {
+		virt->start_time = now;
+		virt->samples = 0;
+	} else if (rate != virt->rate) {
+		virt->start_time = virt->last_due;
+		virt->samples = 0;
+	}
+
+	virt->rate = rate;
+
+	virt->samples += samples;
+	if (rate > 0)
+		virt->last_due = virt->start_time +
+				 (uint64_t)(virt->samples * 1e9 / rate);
+	else
+		virt->last_due = now;
+
+	queue = &virt->queue[virt->queue_len++];
+	queue->xfer = xfer;
+	queue->due = virt->last_due;
+	queue->cancelled = 0;
+
+	pthread_cond_broadcast(&virt->cond);
+	pthread_mutex_unlock(&virt->lock);
+
+	return 0;
+}
+
+int fl2k_virtual_cancel(fl2k_virtual_t *virt, struct libusb_transfer *xfer)
+{
+	uint32_t i;
+	int r = LIBUSB_ERROR_NOT_FOUND;
+
+	pthread_mutex_lock(&virt->lock);
+
+	for (i = 0; i < virt->queue_len; i++) {
+		if (virt->queue[i].xfer == xfer && !virt->queue[i].cancelled) {
+			virt->queue[i].cancelled = 1;
+			r = 0;
+			break;
+		}
+	}
+
+	pthread_cond_broadcast(&virt->cond);
+	pthread_mutex_unlock(&virt->lock);
+
+	return r;
+}
+
+/* Take the first cancelled transfer, or the head of the queue once it is
+ * due, out of the queue. lock has to be held. */
+static struct libusb_transfer *fl2k_virtual_pop(fl2k_virtual_t *virt,
+						uint64_t now, int *cancelled)
+{
+	struct libusb_transfer *xfer;
+	uint32_t i;
+
+	for (i = 0; i < virt->queue_len; i++) {
+		if (virt->queue[i].cancelled)
+			break;
+	}
+
+	if (i == virt->queue_len) {
+		if (!virt->queue_len || virt->queue[0].due > now)
+			return NULL;
+
+		i = 0;
+	}
+
+	xfer = virt->queue[i].xfer;
+	*cancelled = virt->queue[i].cancelled;
+
+	virt->queue_len--;
+	memmove(&virt->queue[i], &virt->queue[i + 1],
+		(virt->queue_len - i) * sizeof(*virt->queue));
+
+	return xfer;
+}
+
+int fl2k_virtual_handle_events(fl2k_virtual_t *virt, struct timeval *tv,
+			       int *completed)
+{
+	struct libusb_transfer *xfer;
+	uint64_t now = fl2k_virtual_time_ns();
+	uint64_t deadline, wakeup;
+	int cancelled, handled = 0;
+
+	deadline = now + (uint64_t)tv->tv_sec * 1000000000ULL +
+		   (uint64_t)tv->tv_usec * 1000ULL;
+
+	pthread_mutex_lock(&virt->lock);
+
+	while (!completed || !fl2k_virtual_flag(completed)) {
+		xfer = fl2k_virtual_pop(virt, now, &cancelled);
+
+		if (xfer) {
+			/* the callback may submit again */
+			pthread_mutex_unlock(&virt->lock);
+
+			if (cancelled) {
+				xfer->status = LIBUSB_TRANSFER_CANCELLED;
+				xfer->actual_length = 0;
+			} else if (virt->sink &&
+				   fwrite(xfer->buffer, 1, xfer->length,
+					  virt->sink) != (size_t)xfer->length) {
+				xfer->status = LIBUSB_TRANSFER_ERROR;
+				xfer->actual_length = 0;
+			} else {
+				xfer->status = LIBUSB_TRANSFER_COMPLETED;
+				xfer->actual_length = xfer->length;
+			}
+
+			xfer->callback(xfer);
+			handled = 1;
+
+			/* transfers submitted by the callbacks are handled
+			 * by the next call, even if already due */
+			pthread_mutex_lock(&virt->lock);
+			continue;
+		}
+
+		if (handled || now >= deadline)
+			break;
+
+		wakeup = deadline;
+		if (virt->queue_len && virt->queue[0].due < wakeup)
+			wakeup = virt->queue[0].due;
+
+		fl2k_virtual_wait(virt, wakeup - now);
+		now = fl2k_virtual_time_ns();
+	}
+
+	pthread_mutex_unlock(&virt->lock);
+
+	return 0;
+}